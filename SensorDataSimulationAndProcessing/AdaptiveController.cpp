@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// Chooses the processor polling rate and collect size from the measured sample rate. The polling interval
+// is half of the target latency, so a sample waits at most one interval to fill the batch and one to be
+// polled, unless the wakeup budget forces a longer interval. The collect size then matches the number of
+// samples that arrive in one interval, so batches neither wait for missing samples nor overflow. It grows
+// as soon as more samples arrive but only shrinks when the rate falls clearly below it, so an estimate
+// that hovers around a boundary does not make the collect size flap.
+class AdaptivePollingController {
+
+    private:
+
+        bool initialized = false;
+        uint64_t lastCount = 0;
+        uint64_t lastTimeMs = 0;
+
+    public:
+
+        int targetLatency = 200;        // Milliseconds a sample may wait before it is processed
+        int maxWakeupsPerSecond = 50;   // CPU budget of the processing thread
+        double smoothing = 0.2;         // Weight of the newest rate measurement
+        double hysteresis = 0.1;        // Relative margin by which the rate must drop before the collect size shrinks
+
+        /* Controller decisions and measurements */
+        double estimatedRate = 0.0;     // Samples per second
+        int pollingRate = 100;
+        int collectSize = 5;
+        uint64_t overflowSamples = 0;   // Samples that arrived beyond the collect size between two polls
+        bool budgetLimited = false;     // True when the wakeup budget does not allow the target latency
+
+        void reset() {
+
+            this->initialized = false;
+            this->estimatedRate = 0.0;
+            this->overflowSamples = 0;
+        }
+
+        // Called once per poll with the total number of generated samples and the current time
+        void update(uint64_t generatedCount, uint64_t nowMs, int maxPollingRate, int maxCollectSize) {
+
+            if (!this->initialized) {
+
+                this->initialized = true;
+                this->lastCount = generatedCount;
+                this->lastTimeMs = nowMs;
+                return;
+            }
+
+            if (nowMs <= this->lastTimeMs) return;
+
+            uint64_t arrived = generatedCount - this->lastCount;
+            double rate = arrived * 1000.0 / (nowMs - this->lastTimeMs);
+            this->estimatedRate = this->estimatedRate == 0.0 ? rate : this->smoothing * rate + (1.0 - this->smoothing) * this->estimatedRate;
+
+            if (arrived > static_cast<uint64_t>(this->collectSize)) {
+
+                this->overflowSamples += arrived - this->collectSize;
+            }
+
+            this->lastCount = generatedCount;
+            this->lastTimeMs = nowMs;
+
+            int minInterval = static_cast<int>(ceil(1000.0 / this->maxWakeupsPerSecond));
+            int interval = max(this->targetLatency / 2, 1);
+            this->budgetLimited = interval < minInterval;
+
+            this->pollingRate = clamp(max(interval, minInterval), 1, maxPollingRate - 1);
+
+            double expected = this->estimatedRate * this->pollingRate / 1000.0;
+            int size = static_cast<int>(ceil(expected));
+            if (size < this->collectSize && ceil(expected * (1.0 + this->hysteresis)) >= this->collectSize) {
+
+                size = this->collectSize;
+            }
+
+            this->collectSize = clamp(size, 1, maxCollectSize - 1);
+        }
+
+        // Expected worst case wait of a sample with the current decisions
+        double getExpectedLatency() {
+
+            if (this->estimatedRate <= 0.0) return 0.0;
+
+            return this->collectSize * 1000.0 / this->estimatedRate + this->pollingRate;
+        }
+
+        double getWakeupsPerSecond() {
+
+            return 1000.0 / this->pollingRate;
+        }
+};
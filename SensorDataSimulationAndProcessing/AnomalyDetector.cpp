@@ -0,0 +1,307 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "ThreadPlacement.cpp"
+
+using namespace std;
+
+#define RULE_ABOVE 0    // value > threshold
+#define RULE_BELOW 1    // value < threshold
+#define RULE_RATE 2     // |value - previous value| > threshold
+#define RULE_ZSCORE 3   // |value - rolling mean| > threshold * rolling standard deviation
+
+inline const char* const anomalyRuleNames[] = { "above", "below", "rate", "zscore" };
+
+#define ANOMALY_BLOCK_SIZE 64
+#define ANOMALY_RECENT_EVENTS 8
+
+struct AnomalyRule {
+
+    int type;
+    double threshold;
+};
+
+// Events carry the rule they matched, so they stay readable after the rules are changed
+struct AnomalyEvent {
+
+    uint64_t timestampNs;   // Arrival time of the batch that contained the sample
+    uint64_t sampleIndex;   // Position of the sample in the evaluated stream
+    int ruleIndex;          // Position of the rule when the event was emitted
+    int ruleType;
+    double threshold;
+    double value;
+};
+
+// Evaluates threshold, rate of change and z-score rules on every incoming batch. The rules are compiled into
+// one flat instruction list, the batch is walked once in blocks of ANOMALY_BLOCK_SIZE samples and every
+// instruction runs as a branch-free loop over the block, which the compiler can vectorize. The rolling mean
+// and variance of a ring of the last windowSize samples are updated per sample with the sliding window form of
+// Welford's algorithm, which does not cancel like a running sum of squares does for large values. They are
+// recomputed from the ring once per windowSize samples, so rounding errors cannot accumulate over a long run.
+class AnomalyDetector {
+
+    private:
+
+        struct Instruction {
+
+            int op;
+            double operand;
+        };
+
+        vector<AnomalyRule> rules;
+        vector<Instruction> program;
+
+        // Rolling window of the last windowSize samples
+        vector<double> window;
+        size_t windowHead = 0;
+        size_t windowCount = 0;
+        double windowMean = 0.0;
+        double windowSquaredDeviations = 0.0;   // Sum of the squared differences from windowMean
+        size_t samplesSinceResum = 0;
+
+        double previousValue = 0.0;
+        bool hasPrevious = false;
+        uint64_t sampleIndex = 0;
+
+        // Block scratch buffers, reused across batches
+        double values[ANOMALY_BLOCK_SIZE];
+        double deltas[ANOMALY_BLOCK_SIZE];
+        double means[ANOMALY_BLOCK_SIZE];
+        double deviations[ANOMALY_BLOCK_SIZE];
+        uint8_t hits[ANOMALY_BLOCK_SIZE];
+
+        deque<AnomalyEvent> recentEvents;
+        vector<AnomalyEvent> latestEvents; // Events of the last evaluate call
+        uint64_t totalEvents = 0;
+
+        void compile() {
+
+            this->program.clear();
+            for (const AnomalyRule& rule : this->rules) {
+
+                this->program.push_back({ rule.type, rule.threshold });
+            }
+        }
+
+        // Rolling statistics before each sample enters the window, then the sample is added
+        void prepareBlock(size_t count) {
+
+            for (size_t i = 0; i < count; i++) {
+
+                double value = this->values[i];
+                this->deltas[i] = this->hasPrevious ? value - this->previousValue : 0.0;
+
+                if (this->windowCount > 1) {
+
+                    this->means[i] = this->windowMean;
+                    this->deviations[i] = sqrt(max(this->windowSquaredDeviations / this->windowCount, 0.0));
+                }
+                else {
+
+                    // Not enough history, a z-score rule cannot fire
+                    this->means[i] = value;
+                    this->deviations[i] = INFINITY;
+                }
+
+                if (this->windowCount == this->window.size()) {
+
+                    // The new sample replaces the oldest one
+                    double removed = this->window[this->windowHead];
+                    double mean = this->windowMean + (value - removed) / this->windowCount;
+                    this->windowSquaredDeviations += (value - removed) * (value - mean + removed - this->windowMean);
+                    this->windowMean = mean;
+                }
+                else {
+
+                    this->windowCount++;
+                    double delta = value - this->windowMean;
+                    this->windowMean += delta / this->windowCount;
+                    this->windowSquaredDeviations += delta * (value - this->windowMean);
+                }
+
+                this->window[this->windowHead] = value;
+                this->windowHead = (this->windowHead + 1) % this->window.size();
+
+                if (++this->samplesSinceResum >= this->window.size()) {
+
+                    resumWindow();
+                }
+
+                this->previousValue = value;
+                this->hasPrevious = true;
+            }
+        }
+
+        // Exact two-pass mean and squared deviations of the samples in the ring
+        void resumWindow() {
+
+            double sum = 0.0;
+            for (size_t i = 0; i < this->windowCount; i++) sum += this->window[i];
+            this->windowMean = this->windowCount > 0 ? sum / this->windowCount : 0.0;
+
+            double squaredDeviations = 0.0;
+            for (size_t i = 0; i < this->windowCount; i++) {
+
+                double deviation = this->window[i] - this->windowMean;
+                squaredDeviations += deviation * deviation;
+            }
+
+            this->windowSquaredDeviations = squaredDeviations;
+            this->samplesSinceResum = 0;
+        }
+
+        void runInstruction(const Instruction& instruction, size_t count) {
+
+            const double operand = instruction.operand;
+
+            switch (instruction.op) {
+
+            case RULE_ABOVE:
+
+                for (size_t i = 0; i < count; i++) this->hits[i] = this->values[i] > operand;
+                break;
+
+            case RULE_BELOW:
+
+                for (size_t i = 0; i < count; i++) this->hits[i] = this->values[i] < operand;
+                break;
+
+            case RULE_RATE:
+
+                for (size_t i = 0; i < count; i++) this->hits[i] = fabs(this->deltas[i]) > operand;
+                break;
+
+            case RULE_ZSCORE:
+
+                for (size_t i = 0; i < count; i++) this->hits[i] = fabs(this->values[i] - this->means[i]) > operand * this->deviations[i];
+                break;
+
+            default:
+
+                fill(this->hits, this->hits + count, 0);
+                break;
+            }
+        }
+
+        void emitEvent(uint64_t timestampNs, uint64_t index, int ruleIndex, double value) {
+
+            const AnomalyRule& rule = this->rules[ruleIndex];
+            AnomalyEvent event{ timestampNs, index, ruleIndex, rule.type, rule.threshold, value };
+
+            this->latestEvents.push_back(event);
+            this->recentEvents.push_back(event);
+            if (this->recentEvents.size() > ANOMALY_RECENT_EVENTS) {
+
+                this->recentEvents.pop_front();
+            }
+
+            this->totalEvents++;
+        }
+
+    public:
+
+        AnomalyDetector(size_t windowSize = 20) {
+
+            setWindowSize(windowSize);
+        }
+
+        bool addRule(int type, double threshold) {
+
+            if (type < RULE_ABOVE || type > RULE_ZSCORE) return false;
+            if ((type == RULE_RATE || type == RULE_ZSCORE) && threshold <= 0.0) return false;
+
+            this->rules.push_back({ type, threshold });
+            compile();
+            return true;
+        }
+
+        void clearRules() {
+
+            this->rules.clear();
+            compile();
+        }
+
+        // Clears the rolling statistics
+        void setWindowSize(size_t windowSize) {
+
+            this->window.assign(max<size_t>(windowSize, 1), 0.0);
+            this->windowHead = 0;
+            this->windowCount = 0;
+            this->windowMean = 0.0;
+            this->windowSquaredDeviations = 0.0;
+            this->samplesSinceResum = 0;
+        }
+
+        template<typename T>
+        void evaluate(const vector<T>& batch, uint64_t timestampNs) {
+
+            this->latestEvents.clear();
+
+            for (size_t start = 0; start < batch.size(); start += ANOMALY_BLOCK_SIZE) {
+
+                size_t count = min<size_t>(ANOMALY_BLOCK_SIZE, batch.size() - start);
+                for (size_t i = 0; i < count; i++) {
+
+                    this->values[i] = static_cast<double>(batch[start + i]);
+                }
+
+                prepareBlock(count);
+
+                for (size_t rule = 0; rule < this->program.size(); rule++) {
+
+                    runInstruction(this->program[rule], count);
+
+                    for (size_t i = 0; i < count; i++) {
+
+                        if (this->hits[i]) emitEvent(timestampNs, this->sampleIndex + i, static_cast<int>(rule), this->values[i]);
+                    }
+                }
+
+                this->sampleIndex += count;
+            }
+        }
+
+        const vector<AnomalyRule>& getRules() {
+
+            return this->rules;
+        }
+
+        const deque<AnomalyEvent>& getRecentEvents() {
+
+            return this->recentEvents;
+        }
+
+        // Reallocate the window and the program from the calling thread, see ThreadPlacement
+        void localizeBuffers() {
+
+            localizeVector(this->window);
+            localizeVector(this->program);
+            localizeVector(this->latestEvents);
+        }
+
+        const vector<AnomalyEvent>& getLatestEvents() {
+
+            return this->latestEvents;
+        }
+
+        // Rolling statistics of the window as the next sample will see them
+        double getRollingMean() {
+
+            return this->windowMean;
+        }
+
+        double getRollingDeviation() {
+
+            return this->windowCount > 0 ? sqrt(max(this->windowSquaredDeviations / this->windowCount, 0.0)) : 0.0;
+        }
+
+        uint64_t getTotalEvents() {
+
+            return this->totalEvents;
+        }
+};
@@ -0,0 +1,820 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <bit>
+#include <limits>
+#include <fstream>
+#include <iostream>
+
+#include "DataPublisher.cpp"
+#include "AnomalyDetector.cpp"
+
+using namespace std;
+
+#define COLUMNAR_FILE_MAGIC 0x46434453 // "SDCF"
+#define COLUMNAR_FILE_VERSION 2
+#define COLUMNAR_ROW_GROUP_MAGIC 0x47434453 // "SDCG"
+#define COLUMNAR_MAX_GROUP_ENTRIES 64
+
+#define COLUMNAR_TABLE_SAMPLES 0    // One row per processed sample: timestamp, raw, filtered
+#define COLUMNAR_TABLE_ROLLUPS 1    // One row per processed batch: timestamp and the statistics fields
+#define COLUMNAR_TABLE_ANOMALIES 2  // One row per anomaly event: timestamp and the anomaly fields
+#define COLUMNAR_TABLE_COUNT 3
+
+#define ENCODING_DELTA_VARINT 1     // Zigzag varints of the delta of deltas, periodic timestamps cost one byte
+#define ENCODING_XOR_FLOAT 2        // XOR with the previous value, only the changed bits are stored
+
+#define SAMPLE_COLUMN_COUNT 3
+#define ROLLUP_COLUMN_COUNT (1 + STATISTICS_FIELD_COUNT)
+#define ANOMALY_COLUMN_COUNT (1 + ANOMALY_FIELD_COUNT)
+
+inline const char* const columnarTableNames[COLUMNAR_TABLE_COUNT] = { "samples", "rollups", "anomalies" };
+
+// Column 0 of every table is the timestamp in nanoseconds since the epoch
+inline const char* const sampleColumnNames[SAMPLE_COLUMN_COUNT] = { "timestamp", "raw", "filtered" };
+
+inline const char* columnarColumnName(int table, int column) {
+
+    if (table == COLUMNAR_TABLE_SAMPLES) return column < SAMPLE_COLUMN_COUNT ? sampleColumnNames[column] : "";
+    if (column == 0) return "timestamp";
+    if (table == COLUMNAR_TABLE_ANOMALIES) return column < ANOMALY_COLUMN_COUNT ? anomalyFieldNames[column - 1] : "";
+    return column < ROLLUP_COLUMN_COUNT ? statisticsFieldNames[column - 1] : "";
+}
+
+inline int columnarColumnCount(int table) {
+
+    if (table == COLUMNAR_TABLE_SAMPLES) return SAMPLE_COLUMN_COUNT;
+    return table == COLUMNAR_TABLE_ANOMALIES ? ANOMALY_COLUMN_COUNT : ROLLUP_COLUMN_COUNT;
+}
+
+// File layout: header, row groups, index, trailer. The index has one entry per column block, the blocks of
+// one row group share its row count and time range, so a reader can skip a row group by time without reading
+// it and read only the columns it needs from the rest. Every row group starts with a copy of its own index
+// entries, so the index of a file whose export crashed before the footer was written can be rebuilt by
+// walking the row groups from the start.
+#pragma pack(push, 1)
+struct ColumnarFileHeader {
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+};
+
+struct ColumnarBlockEntry {
+
+    uint64_t offset;        // Byte offset of the block in the file
+    uint32_t size;          // Encoded size in bytes
+    uint32_t rowCount;
+    uint32_t rowGroup;
+    uint16_t table;
+    uint16_t column;
+    uint16_t encoding;
+    uint16_t reserved;
+    int64_t firstTimestampNs;
+    int64_t lastTimestampNs;
+    double min;             // Zone map of the block, NaN values are left out
+    double max;
+};
+
+// Followed by entryCount index entries and the column blocks they describe
+struct ColumnarRowGroupHeader {
+
+    uint32_t magic;
+    uint32_t entryCount;
+};
+
+struct ColumnarFileTrailer {
+
+    uint64_t indexOffset;
+    uint32_t entryCount;
+    uint32_t magic;
+};
+#pragma pack(pop)
+
+// Block encodings. Timestamps are delta-of-delta zigzag varints. Values use the XOR scheme of Facebook's
+// Gorilla: a repeated value costs one bit, otherwise only the bits between the leading and trailing zeros of
+// the XOR with the previous value are stored, reusing the previous bit window when the new one fits inside it.
+class ColumnarCodec {
+
+    private:
+
+        class BitWriter {
+
+            private:
+
+                vector<uint8_t>& output;
+                uint64_t accumulator = 0;
+                int pending = 0; // Bits in the accumulator that are not written yet, always below 8 between calls
+
+            public:
+
+                BitWriter(vector<uint8_t>& output) : output(output) {}
+
+                // Most significant bit first, count up to 64
+                void write(uint64_t value, int count) {
+
+                    if (count > 32) {
+
+                        write(value >> 32, count - 32);
+                        value &= 0xFFFFFFFFULL;
+                        count = 32;
+                    }
+
+                    this->accumulator = (this->accumulator << count) | (value & ((1ULL << count) - 1));
+                    this->pending += count;
+
+                    while (this->pending >= 8) {
+
+                        this->pending -= 8;
+                        this->output.push_back(static_cast<uint8_t>(this->accumulator >> this->pending));
+                    }
+                }
+
+                void finish() {
+
+                    if (this->pending > 0) this->output.push_back(static_cast<uint8_t>(this->accumulator << (8 - this->pending)));
+                    this->pending = 0;
+                }
+        };
+
+        class BitReader {
+
+            private:
+
+                const uint8_t* data;
+                size_t size;
+                size_t position = 0; // In bits
+
+            public:
+
+                BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+                uint64_t read(int count) {
+
+                    if (count > 32) {
+
+                        uint64_t high = read(count - 32);
+                        return (high << 32) | read(32);
+                    }
+
+                    uint64_t value = 0;
+                    while (count > 0) {
+
+                        size_t byte = this->position >> 3;
+                        int available = 8 - static_cast<int>(this->position & 7);
+                        int take = min(available, count);
+                        uint8_t current = byte < this->size ? this->data[byte] : 0;
+
+                        value = (value << take) | ((current >> (available - take)) & ((1u << take) - 1));
+                        this->position += take;
+                        count -= take;
+                    }
+
+                    return value;
+                }
+
+                bool overrun() {
+
+                    return this->position > this->size * 8;
+                }
+        };
+
+    public:
+
+        static void encodeTimestamps(const vector<int64_t>& timestamps, vector<uint8_t>& output) {
+
+            uint64_t previous = 0;
+            uint64_t previousDelta = 0;
+
+            for (int64_t timestamp : timestamps) {
+
+                // Unsigned arithmetic wraps instead of overflowing
+                uint64_t delta = static_cast<uint64_t>(timestamp) - previous;
+                int64_t deltaOfDelta = static_cast<int64_t>(delta - previousDelta);
+                uint64_t zigzag = (static_cast<uint64_t>(deltaOfDelta) << 1) ^ static_cast<uint64_t>(deltaOfDelta >> 63);
+
+                while (zigzag >= 0x80) {
+
+                    output.push_back(static_cast<uint8_t>(zigzag | 0x80));
+                    zigzag >>= 7;
+                }
+                output.push_back(static_cast<uint8_t>(zigzag));
+
+                previous = static_cast<uint64_t>(timestamp);
+                previousDelta = delta;
+            }
+        }
+
+        static bool decodeTimestamps(const uint8_t* data, size_t size, size_t count, vector<int64_t>& timestamps) {
+
+            timestamps.resize(count);
+            uint64_t previous = 0;
+            uint64_t previousDelta = 0;
+            size_t position = 0;
+
+            for (size_t i = 0; i < count; i++) {
+
+                uint64_t zigzag = 0;
+                int shift = 0;
+
+                while (true) {
+
+                    if (position >= size || shift > 63) return false;
+
+                    uint8_t byte = data[position++];
+                    zigzag |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    shift += 7;
+                    if ((byte & 0x80) == 0) break;
+                }
+
+                uint64_t deltaOfDelta = (zigzag >> 1) ^ (0 - (zigzag & 1));
+                previousDelta += deltaOfDelta;
+                previous += previousDelta;
+                timestamps[i] = static_cast<int64_t>(previous);
+            }
+
+            return true;
+        }
+
+        static void encodeValues(const vector<double>& values, vector<uint8_t>& output) {
+
+            BitWriter writer(output);
+            uint64_t previous = 0;
+            int previousLeading = -1;
+            int previousTrailing = 0;
+
+            for (size_t i = 0; i < values.size(); i++) {
+
+                uint64_t bits = bit_cast<uint64_t>(values[i]);
+
+                if (i == 0) {
+
+                    writer.write(bits, 64);
+                    previous = bits;
+                    continue;
+                }
+
+                uint64_t difference = bits ^ previous;
+                previous = bits;
+
+                if (difference == 0) {
+
+                    writer.write(0, 1);
+                    continue;
+                }
+
+                int leading = min(countl_zero(difference), 31); // Stored in 5 bits
+                int trailing = countr_zero(difference);
+
+                if (previousLeading >= 0 && leading >= previousLeading && trailing >= previousTrailing) {
+
+                    writer.write(0b10, 2);
+                    writer.write(difference >> previousTrailing, 64 - previousLeading - previousTrailing);
+                }
+                else {
+
+                    int meaningful = 64 - leading - trailing;
+                    writer.write(0b11, 2);
+                    writer.write(leading, 5);
+                    writer.write(meaningful - 1, 6);
+                    writer.write(difference >> trailing, meaningful);
+
+                    previousLeading = leading;
+                    previousTrailing = trailing;
+                }
+            }
+
+            writer.finish();
+        }
+
+        static bool decodeValues(const uint8_t* data, size_t size, size_t count, vector<double>& values) {
+
+            values.resize(count);
+            BitReader reader(data, size);
+            uint64_t previous = 0;
+            int leading = 0;
+            int trailing = 0;
+
+            for (size_t i = 0; i < count; i++) {
+
+                if (i == 0) {
+
+                    previous = reader.read(64);
+                }
+                else if (reader.read(1) == 1) {
+
+                    if (reader.read(1) == 1) {
+
+                        leading = static_cast<int>(reader.read(5));
+                        int meaningful = static_cast<int>(reader.read(6)) + 1;
+                        trailing = 64 - leading - meaningful;
+                        if (trailing < 0) return false;
+                    }
+
+                    previous ^= reader.read(64 - leading - trailing) << trailing;
+                }
+
+                values[i] = bit_cast<double>(previous);
+            }
+
+            return !reader.overrun();
+        }
+};
+
+// Chunked columnar file sink for processed data. append() only copies the batch into per-column buffers;
+// once a table has blockRows rows, or flushInterval ms passed, the buffered rows are sealed into a row group
+// and a background thread encodes every column into its own block and writes it. The index with the zone
+// maps of all blocks is written as a footer when the export stops. Until then a reader recovers the index
+// from the row group headers.
+class ColumnarExporter {
+
+    private:
+
+        struct RowGroup {
+
+            int table = 0;
+            vector<int64_t> timestamps;
+            vector<vector<double>> columns;
+        };
+
+        mutex bufferMutex;
+        condition_variable flushCondition;
+        RowGroup buffers[COLUMNAR_TABLE_COUNT];
+        deque<RowGroup> sealed;
+        atomic<bool> active{ false };
+        thread worker;
+
+        // Only touched by the worker thread while active
+        ofstream file;
+        string path;
+        uint64_t fileOffset = 0;
+        uint32_t rowGroupCount = 0;
+        vector<ColumnarBlockEntry> index;
+
+        atomic<uint64_t> rowsExported{ 0 };
+        atomic<uint64_t> rowsDropped{ 0 };
+        atomic<uint64_t> blocksWritten{ 0 };
+        atomic<uint64_t> bytesWritten{ 0 };
+
+        void resetBuffers() {
+
+            for (int table = 0; table < COLUMNAR_TABLE_COUNT; table++) {
+
+                this->buffers[table].table = table;
+                this->buffers[table].timestamps.clear();
+                this->buffers[table].columns.assign(columnarColumnCount(table) - 1, vector<double>());
+            }
+        }
+
+        // Called with bufferMutex held
+        void seal(int table) {
+
+            RowGroup& buffer = this->buffers[table];
+            if (buffer.timestamps.empty()) return;
+
+            RowGroup group;
+            group.table = table;
+            group.columns.resize(buffer.columns.size());
+            group.timestamps.swap(buffer.timestamps);
+            for (size_t column = 0; column < buffer.columns.size(); column++) {
+
+                group.columns[column].swap(buffer.columns[column]);
+            }
+
+            this->sealed.push_back(move(group));
+        }
+
+        ColumnarBlockEntry blockEntry(const RowGroup& group, int column, size_t size, uint16_t encoding, int64_t first, int64_t last, double minimum, double maximum) {
+
+            ColumnarBlockEntry entry{};
+            entry.size = static_cast<uint32_t>(size);
+            entry.rowCount = static_cast<uint32_t>(group.timestamps.size());
+            entry.rowGroup = this->rowGroupCount;
+            entry.table = static_cast<uint16_t>(group.table);
+            entry.column = static_cast<uint16_t>(column);
+            entry.encoding = encoding;
+            entry.firstTimestampNs = first;
+            entry.lastTimestampNs = last;
+            entry.min = minimum;
+            entry.max = maximum;
+            return entry;
+        }
+
+        // Encodes every column first, so that the row group header can carry the final block offsets
+        void writeRowGroup(const RowGroup& group) {
+
+            vector<vector<uint8_t>> blocks(group.columns.size() + 1);
+            vector<ColumnarBlockEntry> entries;
+
+            // Batches of one pipeline arrive in time order, but several pipelines may interleave
+            int64_t first = group.timestamps.front();
+            int64_t last = group.timestamps.front();
+            for (int64_t timestamp : group.timestamps) {
+
+                first = min(first, timestamp);
+                last = max(last, timestamp);
+            }
+
+            ColumnarCodec::encodeTimestamps(group.timestamps, blocks[0]);
+            entries.push_back(blockEntry(group, 0, blocks[0].size(), ENCODING_DELTA_VARINT, first, last, static_cast<double>(first), static_cast<double>(last)));
+
+            for (size_t column = 0; column < group.columns.size(); column++) {
+
+                double minimum = numeric_limits<double>::quiet_NaN();
+                double maximum = numeric_limits<double>::quiet_NaN();
+                for (double value : group.columns[column]) {
+
+                    if (isnan(value)) continue;
+                    if (!(value >= minimum)) minimum = value;
+                    if (!(value <= maximum)) maximum = value;
+                }
+
+                ColumnarCodec::encodeValues(group.columns[column], blocks[column + 1]);
+                entries.push_back(blockEntry(group, static_cast<int>(column) + 1, blocks[column + 1].size(), ENCODING_XOR_FLOAT, first, last, minimum, maximum));
+            }
+
+            ColumnarRowGroupHeader header{ COLUMNAR_ROW_GROUP_MAGIC, static_cast<uint32_t>(entries.size()) };
+            uint64_t offset = this->fileOffset + sizeof(header) + entries.size() * sizeof(ColumnarBlockEntry);
+            for (ColumnarBlockEntry& entry : entries) {
+
+                entry.offset = offset;
+                offset += entry.size;
+            }
+
+            this->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            this->file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ColumnarBlockEntry));
+            for (const vector<uint8_t>& block : blocks) {
+
+                this->file.write(reinterpret_cast<const char*>(block.data()), block.size());
+            }
+
+            this->fileOffset = offset;
+            this->index.insert(this->index.end(), entries.begin(), entries.end());
+            this->blocksWritten += entries.size();
+            this->rowGroupCount++;
+        }
+
+        void writeFooter() {
+
+            ColumnarFileTrailer trailer{};
+            trailer.indexOffset = this->fileOffset;
+            trailer.entryCount = static_cast<uint32_t>(this->index.size());
+            trailer.magic = COLUMNAR_FILE_MAGIC;
+
+            this->file.write(reinterpret_cast<const char*>(this->index.data()), this->index.size() * sizeof(ColumnarBlockEntry));
+            this->file.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+            this->fileOffset += this->index.size() * sizeof(ColumnarBlockEntry) + sizeof(trailer);
+        }
+
+        void flushTask() {
+
+            deque<RowGroup> groups;
+
+            while (true) {
+
+                bool stopping;
+                {
+                    unique_lock<mutex> lock(this->bufferMutex);
+                    this->flushCondition.wait_for(lock, chrono::milliseconds(this->flushInterval), [this] { return !this->sealed.empty() || !this->active; });
+
+                    // Woken by the interval or by stop, partially filled row groups are written as well
+                    stopping = !this->active;
+                    if (this->sealed.empty() || stopping) {
+
+                        for (int table = 0; table < COLUMNAR_TABLE_COUNT; table++) seal(table);
+                    }
+
+                    groups.swap(this->sealed);
+                }
+
+                for (const RowGroup& group : groups) {
+
+                    writeRowGroup(group);
+                }
+
+                if (!groups.empty()) this->file.flush();
+                groups.clear();
+                this->bytesWritten = this->fileOffset;
+
+                if (stopping) break;
+            }
+
+            writeFooter();
+            this->file.close();
+            this->bytesWritten = this->fileOffset;
+        }
+
+    public:
+
+        size_t blockRows = 4096;        // Rows of one table buffered before they are sealed into a row group
+        int flushInterval = 2000;       // Milliseconds after which partially filled row groups are written anyway
+        size_t maxSealedGroups = 64;    // Row groups waiting for the flush thread before new rows are dropped
+
+        ~ColumnarExporter() {
+
+            stop();
+        }
+
+        bool start(const string& path) {
+
+            if (this->active) return true;
+
+            this->file.open(path, ios::binary | ios::trunc);
+            if (!this->file) {
+
+                cout << "Columnar export could not open " << path;
+                return false;
+            }
+
+            ColumnarFileHeader header{};
+            header.magic = COLUMNAR_FILE_MAGIC;
+            header.version = COLUMNAR_FILE_VERSION;
+            this->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            this->path = path;
+            this->fileOffset = sizeof(header);
+            this->rowGroupCount = 0;
+            this->index.clear();
+            this->sealed.clear();
+            resetBuffers();
+            this->rowsExported = 0;
+            this->rowsDropped = 0;
+            this->blocksWritten = 0;
+            this->bytesWritten = this->fileOffset;
+
+            this->active = true;
+            this->worker = thread(&ColumnarExporter::flushTask, this);
+            return true;
+        }
+
+        // Writes the remaining rows and the footer, the file is complete when this returns
+        void stop() {
+
+            {
+                lock_guard<mutex> lock(this->bufferMutex);
+                if (!this->active) return;
+
+                this->active = false;
+            }
+
+            this->flushCondition.notify_all();
+            if (this->worker.joinable()) this->worker.join();
+        }
+
+        // One processed batch at timestampNs: the raw samples with their generation times, the filtered values of the
+        // batch aligned to its last samples, and the STATISTICS_FIELD_COUNT rollup statistics in DataPublisher order.
+        // Samples without a generation time, sampleTimestamps empty, are stamped with timestampNs.
+        template<typename T>
+        void append(int64_t timestampNs, const vector<int64_t>& sampleTimestamps, const vector<T>& raw, const vector<double>& filtered, const vector<double>& statistics) {
+
+            if (raw.empty()) return;
+
+            lock_guard<mutex> lock(this->bufferMutex);
+            if (!this->active) return;
+
+            if (this->sealed.size() >= this->maxSealedGroups) {
+
+                this->rowsDropped += raw.size() + 1;
+                return;
+            }
+
+            RowGroup& samples = this->buffers[COLUMNAR_TABLE_SAMPLES];
+            size_t unfiltered = raw.size() - min(filtered.size(), raw.size());
+            size_t filteredOffset = filtered.size() - (raw.size() - unfiltered);
+
+            for (size_t i = 0; i < raw.size(); i++) {
+
+                samples.timestamps.push_back(sampleTimestamps.size() == raw.size() ? sampleTimestamps[i] : timestampNs);
+                samples.columns[0].push_back(static_cast<double>(raw[i]));
+                samples.columns[1].push_back(i < unfiltered ? numeric_limits<double>::quiet_NaN() : filtered[filteredOffset + i - unfiltered]);
+            }
+
+            RowGroup& rollups = this->buffers[COLUMNAR_TABLE_ROLLUPS];
+            rollups.timestamps.push_back(timestampNs);
+            for (size_t field = 0; field < rollups.columns.size(); field++) {
+
+                rollups.columns[field].push_back(field < statistics.size() ? statistics[field] : numeric_limits<double>::quiet_NaN());
+            }
+
+            this->rowsExported += raw.size() + 1;
+
+            bool notify = false;
+            for (int table = 0; table < COLUMNAR_TABLE_COUNT; table++) {
+
+                if (this->buffers[table].timestamps.size() >= this->blockRows) {
+
+                    seal(table);
+                    notify = true;
+                }
+            }
+
+            if (notify) this->flushCondition.notify_one();
+        }
+
+        // The anomaly events of one processed batch, in the order of ANOMALY_FIELD_COUNT
+        void appendAnomalies(const vector<AnomalyEvent>& events) {
+
+            if (events.empty()) return;
+
+            lock_guard<mutex> lock(this->bufferMutex);
+            if (!this->active) return;
+
+            if (this->sealed.size() >= this->maxSealedGroups) {
+
+                this->rowsDropped += events.size();
+                return;
+            }
+
+            RowGroup& anomalies = this->buffers[COLUMNAR_TABLE_ANOMALIES];
+            for (const AnomalyEvent& event : events) {
+
+                anomalies.timestamps.push_back(static_cast<int64_t>(event.timestampNs));
+                anomalies.columns[0].push_back(static_cast<double>(event.sampleIndex));
+                anomalies.columns[1].push_back(event.ruleType);
+                anomalies.columns[2].push_back(event.threshold);
+                anomalies.columns[3].push_back(event.value);
+            }
+
+            this->rowsExported += events.size();
+
+            if (anomalies.timestamps.size() >= this->blockRows) {
+
+                seal(COLUMNAR_TABLE_ANOMALIES);
+                this->flushCondition.notify_one();
+            }
+        }
+
+        bool setBlockRows(int value) {
+
+            if (value < 16 || value > (1 << 20)) {
+
+                cout << "Invalid export block size. Block size must be between 16 and " << (1 << 20) << " rows.";
+                return false;
+            }
+
+            lock_guard<mutex> lock(this->bufferMutex);
+            this->blockRows = value;
+            cout << "Export block size successfully set.";
+            return true;
+        }
+
+        bool isActive() {
+
+            return this->active;
+        }
+
+        string getPath() {
+
+            return this->path;
+        }
+
+        uint64_t getRowsExported() {
+
+            return this->rowsExported;
+        }
+
+        uint64_t getRowsDropped() {
+
+            return this->rowsDropped;
+        }
+
+        uint64_t getBlocksWritten() {
+
+            return this->blocksWritten;
+        }
+
+        uint64_t getBytesWritten() {
+
+            return this->bytesWritten;
+        }
+};
+
+// Reads the index of a finished export file and decodes single column blocks on demand
+class ColumnarFileReader {
+
+    private:
+
+        ifstream file;
+        vector<ColumnarBlockEntry> index;
+        bool recovered = false;
+
+        // Rebuild the index from the row group headers. Stops at the first row group that was not completely
+        // written, the rows of the complete ones stay readable.
+        bool recoverIndex(uint64_t fileSize) {
+
+            uint64_t position = sizeof(ColumnarFileHeader);
+
+            while (position + sizeof(ColumnarRowGroupHeader) <= fileSize) {
+
+                ColumnarRowGroupHeader header{};
+                this->file.clear();
+                this->file.seekg(position);
+                this->file.read(reinterpret_cast<char*>(&header), sizeof(header));
+                if (!this->file || header.magic != COLUMNAR_ROW_GROUP_MAGIC || header.entryCount == 0 || header.entryCount > COLUMNAR_MAX_GROUP_ENTRIES) break;
+
+                uint64_t end = position + sizeof(header) + static_cast<uint64_t>(header.entryCount) * sizeof(ColumnarBlockEntry);
+                if (end > fileSize) break;
+
+                vector<ColumnarBlockEntry> entries(header.entryCount);
+                this->file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(ColumnarBlockEntry));
+                if (!this->file) break;
+
+                // The blocks follow the entries back to back
+                bool complete = true;
+                for (const ColumnarBlockEntry& entry : entries) {
+
+                    complete = complete && entry.offset == end && entry.table < COLUMNAR_TABLE_COUNT;
+                    end += entry.size;
+                }
+
+                if (!complete || end > fileSize) break;
+
+                this->index.insert(this->index.end(), entries.begin(), entries.end());
+                position = end;
+            }
+
+            this->recovered = true;
+            this->file.clear();
+            return true;
+        }
+
+        bool readBlock(const ColumnarBlockEntry& entry, vector<uint8_t>& bytes) {
+
+            bytes.resize(entry.size);
+            this->file.clear();
+            this->file.seekg(entry.offset);
+            this->file.read(reinterpret_cast<char*>(bytes.data()), entry.size);
+            return static_cast<bool>(this->file);
+        }
+
+    public:
+
+        // Fails for files that are not export files. Without a footer, because the export was not stopped or
+        // crashed, the index is recovered from the row groups.
+        bool open(const string& path) {
+
+            this->file.close();
+            this->index.clear();
+            this->recovered = false;
+
+            this->file.open(path, ios::binary);
+            if (!this->file) return false;
+
+            ColumnarFileHeader header{};
+            this->file.read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!this->file || header.magic != COLUMNAR_FILE_MAGIC || header.version != COLUMNAR_FILE_VERSION) return false;
+
+            this->file.seekg(0, ios::end);
+            uint64_t fileSize = static_cast<uint64_t>(this->file.tellg());
+            if (fileSize < sizeof(header) + sizeof(ColumnarFileTrailer)) return recoverIndex(fileSize);
+
+            ColumnarFileTrailer trailer{};
+            this->file.seekg(fileSize - sizeof(trailer));
+            this->file.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+            if (!this->file || trailer.magic != COLUMNAR_FILE_MAGIC
+                || trailer.indexOffset + static_cast<uint64_t>(trailer.entryCount) * sizeof(ColumnarBlockEntry) + sizeof(trailer) != fileSize) {
+
+                return recoverIndex(fileSize);
+            }
+
+            this->index.resize(trailer.entryCount);
+            this->file.seekg(trailer.indexOffset);
+            this->file.read(reinterpret_cast<char*>(this->index.data()), this->index.size() * sizeof(ColumnarBlockEntry));
+            return static_cast<bool>(this->file);
+        }
+
+        // True when the file had no footer and the index was rebuilt from the row groups
+        bool isRecovered() {
+
+            return this->recovered;
+        }
+
+        const vector<ColumnarBlockEntry>& getIndex() {
+
+            return this->index;
+        }
+
+        bool readTimestamps(const ColumnarBlockEntry& entry, vector<int64_t>& timestamps) {
+
+            vector<uint8_t> bytes;
+            return entry.encoding == ENCODING_DELTA_VARINT && readBlock(entry, bytes)
+                && ColumnarCodec::decodeTimestamps(bytes.data(), bytes.size(), entry.rowCount, timestamps);
+        }
+
+        bool readValues(const ColumnarBlockEntry& entry, vector<double>& values) {
+
+            vector<uint8_t> bytes;
+            return entry.encoding == ENCODING_XOR_FLOAT && readBlock(entry, bytes)
+                && ColumnarCodec::decodeValues(bytes.data(), bytes.size(), entry.rowCount, values);
+        }
+};
@@ -0,0 +1,227 @@
+// ColumnarReader.cpp: Reads a columnar export file and prints the rows in a time range as CSV.
+// Row groups outside the range are skipped using the footer index, only the requested columns are decoded.
+// A file without a footer, from an export that is still running or crashed, is read from its row group headers.
+// Usage: ColumnarReader FILE [--table samples|rollups|anomalies] [--from MS] [--to MS] [--columns name,name] [--index]
+//   --from, --to  Milliseconds since the epoch, inclusive
+//   --index       Print the row groups with their time ranges and zone maps instead of the rows
+
+#include <map>
+#include <sstream>
+#include <iomanip>
+
+#include "ColumnarExporter.cpp"
+
+using namespace std;
+
+namespace {
+
+    struct Options {
+
+        string path;
+        int table = COLUMNAR_TABLE_SAMPLES;
+        int64_t fromNs = numeric_limits<int64_t>::min();
+        int64_t toNs = numeric_limits<int64_t>::max();
+        vector<int> columns; // Empty - all columns
+        bool indexOnly = false;
+    };
+
+    // Milliseconds since the epoch as nanoseconds, a malformed or too large value is a usage error instead of an exception
+    bool parseMilliseconds(const string& option, const string& text, int64_t& valueNs) {
+
+        const uint64_t maxValue = numeric_limits<int64_t>::max() / 1000000 - 1;
+        uint64_t value = 0;
+        size_t used = 0;
+
+        try {
+
+            if (!text.empty() && isdigit(static_cast<unsigned char>(text[0]))) value = stoull(text, &used);
+        }
+        catch (const exception&) {
+
+            used = 0;
+        }
+
+        if (used == 0 || used != text.size() || value > maxValue) {
+
+            cerr << "Invalid value for " << option << ": " << text << ", milliseconds since the epoch from 0 to " << maxValue << " are expected\n";
+            return false;
+        }
+
+        valueNs = static_cast<int64_t>(value) * 1000000;
+        return true;
+    }
+
+    bool parseColumns(const string& list, int table, vector<int>& columns) {
+
+        stringstream stream(list);
+        string name;
+
+        while (getline(stream, name, ',')) {
+
+            int found = -1;
+            for (int column = 1; column < columnarColumnCount(table); column++) {
+
+                if (name == columnarColumnName(table, column)) found = column;
+            }
+
+            if (found < 0) {
+
+                cerr << "Unknown column: " << name << "\n";
+                return false;
+            }
+
+            columns.push_back(found);
+        }
+
+        return true;
+    }
+
+    void printIndex(ColumnarFileReader& reader, const Options& options) {
+
+        cout << "rowGroup,table,column,rows,bytes,fromMs,toMs,min,max\n";
+
+        for (const ColumnarBlockEntry& entry : reader.getIndex()) {
+
+            if (entry.table != options.table) continue;
+
+            cout << entry.rowGroup << "," << columnarTableNames[entry.table] << ","
+                << columnarColumnName(entry.table, entry.column) << "," << entry.rowCount << "," << entry.size << ","
+                << entry.firstTimestampNs / 1000000 << "," << entry.lastTimestampNs / 1000000 << ","
+                << setprecision(10) << entry.min << "," << entry.max << "\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+    string columnList;
+
+    for (int i = 1; i < argc; i++) {
+
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--table" && hasValue) {
+
+            string table = argv[++i];
+            options.table = -1;
+            for (int t = 0; t < COLUMNAR_TABLE_COUNT; t++) {
+
+                if (table == columnarTableNames[t]) options.table = t;
+            }
+
+            if (options.table < 0) {
+
+                cerr << "Unknown table: " << table << ", samples, rollups or anomalies\n";
+                return 2;
+            }
+        }
+        else if (argument == "--from" && hasValue) {
+
+            if (!parseMilliseconds(argument, argv[++i], options.fromNs)) return 2;
+        }
+        else if (argument == "--to" && hasValue) {
+
+            if (!parseMilliseconds(argument, argv[++i], options.toNs)) return 2;
+            options.toNs += 999999;
+        }
+        else if (argument == "--columns" && hasValue) columnList = argv[++i];
+        else if (argument == "--index") options.indexOnly = true;
+        else if (options.path.empty() && argument[0] != '-') options.path = argument;
+        else {
+
+            cerr << "Unknown option: " << argument << "\n";
+            return 2;
+        }
+    }
+
+    if (options.path.empty()) {
+
+        cerr << "Usage: ColumnarReader FILE [--table samples|rollups|anomalies] [--from MS] [--to MS] [--columns name,name] [--index]\n";
+        return 2;
+    }
+
+    if (!columnList.empty() && !parseColumns(columnList, options.table, options.columns)) {
+
+        return 2;
+    }
+
+    if (options.columns.empty()) {
+
+        for (int column = 1; column < columnarColumnCount(options.table); column++) options.columns.push_back(column);
+    }
+
+    ColumnarFileReader reader;
+    if (!reader.open(options.path)) {
+
+        cerr << "Could not read " << options.path << ", not an export file\n";
+        return 1;
+    }
+
+    if (reader.isRecovered()) {
+
+        cerr << "No footer, the index of " << reader.getIndex().size() << " blocks was recovered from the row groups\n";
+    }
+
+    if (options.indexOnly) {
+
+        printIndex(reader, options);
+        return 0;
+    }
+
+    // Blocks of the selected table by row group and column
+    map<uint32_t, map<int, const ColumnarBlockEntry*>> rowGroups;
+    for (const ColumnarBlockEntry& entry : reader.getIndex()) {
+
+        if (entry.table == options.table) rowGroups[entry.rowGroup][entry.column] = &entry;
+    }
+
+    cout << "timestamp";
+    for (int column : options.columns) cout << "," << columnarColumnName(options.table, column);
+    cout << "\n" << setprecision(17);
+
+    size_t groupsRead = 0, groupsSkipped = 0, blocksRead = 0;
+    vector<int64_t> timestamps;
+    vector<vector<double>> values(options.columns.size());
+
+    for (auto& [rowGroup, blocks] : rowGroups) {
+
+        const ColumnarBlockEntry* timestampBlock = blocks[0];
+        if (timestampBlock == nullptr) continue;
+
+        if (timestampBlock->lastTimestampNs < options.fromNs || timestampBlock->firstTimestampNs > options.toNs) {
+
+            groupsSkipped++;
+            continue;
+        }
+
+        bool complete = reader.readTimestamps(*timestampBlock, timestamps);
+        for (size_t i = 0; i < options.columns.size() && complete; i++) {
+
+            const ColumnarBlockEntry* block = blocks[options.columns[i]];
+            complete = block != nullptr && reader.readValues(*block, values[i]);
+        }
+
+        if (!complete) {
+
+            cerr << "Row group " << rowGroup << " is damaged\n";
+            return 1;
+        }
+
+        groupsRead++;
+        blocksRead += 1 + options.columns.size();
+
+        for (size_t row = 0; row < timestamps.size(); row++) {
+
+            if (timestamps[row] < options.fromNs || timestamps[row] > options.toNs) continue;
+
+            cout << timestamps[row];
+            for (const vector<double>& column : values) cout << "," << column[row];
+            cout << "\n";
+        }
+    }
+
+    cerr << "Read " << groupsRead << " row groups (" << blocksRead << " blocks), skipped " << groupsSkipped << " by time range\n";
+    return 0;
+}
@@ -1,8 +1,22 @@
+#pragma once
+
 #include <iomanip> // For formatting output
 #include <algorithm> // For min_element and max_element
 
+#include <chrono>
+#include <mutex>
+
+#include "QuantileSketch.cpp"
+#include "AnomalyDetector.cpp"
+#include "SpectralAnalyzer.cpp"
+#include "SimulationClock.cpp"
+
 using namespace std;
 
+// Defined by the test and benchmark targets to reach the private filter stages
+template<typename dataType>
+struct DataProcessorProbe;
+
 template<typename dataType>
 class DataProcessor {
 
@@ -13,32 +27,38 @@ class DataProcessor {
 		int maxRawDataSize = 600;
 		int filterType = 1; // 0: No filter, 1: Moving average filter
 		int filterSize = 5; // Filter size for moving average filter
+		int sketchAccuracy = 1; // Relative accuracy of the percentile sketches in percent
+		int sketchMaxBuckets = 2048; // Memory limit of each percentile sketch
+		int spectrumSize = 64; // Samples per spectral frame, 0: Spectral analysis off
+		int spectrumOverlap = 50; // Overlap of consecutive spectral frames in percent
 
-		void setFilterType(int filterType) {
+		bool setFilterType(int filterType) {
 
 			if (filterType >= 0 && filterType <= 1) {
 
 				this->filterType = filterType;
 				cout << "Data processor filter type successfully set.";
-				return;
+				return true;
 			}
 
 			cout << "Invalid filter type. 0 - No filter, 1 - Moving average filter";
+			return false;
 		}
 
-		void setFilterSize(int filterSize) {
+		bool setFilterSize(int filterSize) {
 
 			if (filterSize > 0 && filterSize < rawDataSize) {
 
 				this->filterSize = filterSize;
 				cout << "Data processor filter size successfully set.";
-				return;
+				return true;
 			}
 
 			cout << "Invalid filter size. Filter size must be greater than 0 and must be less than " << rawDataSize;
+			return false;
 		}
 
-		void setRawDataSize(int value) {
+		bool setRawDataSize(int value) {
 
 			if (value > 0 && value < this->maxRawDataSize) {
 
@@ -48,17 +68,169 @@ class DataProcessor {
 				this->rawData = vector<dataType>(value, 0);
 				this->filteredData.clear();
 				this->filteredData = vector<double>(value, 0);
+				configureSketches();
+				{
+					lock_guard<mutex> lock(this->detectorMutex);
+					this->anomalyDetector.setWindowSize(value);
+				}
 				cout << "Data processor raw data size successfully set.";
-				return;
+				return true;
 			}
 
 			cout << "Invalid raw data size. Raw data size must be greater than 0 and must be less than " << this->maxRawDataSize;
+			return false;
+		}
+
+		bool setSketchAccuracy(int percent) {
+
+			if (percent > 0 && percent < 50) {
+
+				this->sketchAccuracy = percent;
+				configureSketches();
+				cout << "Data processor sketch accuracy successfully set.";
+				return true;
+			}
+
+			cout << "Invalid sketch accuracy. Sketch accuracy must be greater than 0 and less than 50 percent";
+			return false;
+		}
+
+		bool setSketchMaxBuckets(int value) {
+
+			if (value >= 16 && value <= 65536) {
+
+				this->sketchMaxBuckets = value;
+				configureSketches();
+				cout << "Data processor sketch bucket limit successfully set.";
+				return true;
+			}
+
+			cout << "Invalid sketch bucket limit. Bucket limit must be between 16 and 65536";
+			return false;
+		}
+
+		bool setSpectrumSize(int value) {
+
+			if (value == 0 || (value >= SPECTRAL_MIN_FRAME && value <= SPECTRAL_MAX_FRAME && (value & (value - 1)) == 0)) {
+
+				this->spectrumSize = value;
+				configureSpectrum();
+				cout << "Data processor spectrum size successfully set.";
+				return true;
+			}
+
+			cout << "Invalid spectrum size. Spectrum size must be 0 (off) or a power of two between " << SPECTRAL_MIN_FRAME << " and " << SPECTRAL_MAX_FRAME;
+			return false;
+		}
+
+		bool setSpectrumOverlap(int percent) {
+
+			if (percent >= 0 && percent <= 90) {
+
+				this->spectrumOverlap = percent;
+				configureSpectrum();
+				cout << "Data processor spectrum overlap successfully set.";
+				return true;
+			}
+
+			cout << "Invalid spectrum overlap. Overlap must be between 0 and 90 percent";
+			return false;
 		}
 
-		void inputData(vector<dataType> data) {
+		// Sample rate the spectrum bins are labelled with, set from the command thread while frames are computed
+		void setSpectrumSampleRate(double hz) {
 
+			lock_guard<mutex> lock(this->spectrumMutex);
+			this->spectralAnalyzer.setSampleRate(hz);
+		}
+
+		SpectralAnalyzer& getSpectralAnalyzer() {
+
+			return this->spectralAnalyzer;
+		}
+
+		// Rule types: above, below, rate (change between two samples), zscore (against the rolling window)
+		bool addAnomalyRule(const string& type, double threshold) {
+
+			int ruleType = type == "above" ? RULE_ABOVE : type == "below" ? RULE_BELOW : type == "rate" ? RULE_RATE : type == "zscore" ? RULE_ZSCORE : -1;
+
+			bool added;
+			{
+				lock_guard<mutex> lock(this->detectorMutex);
+				added = this->anomalyDetector.addRule(ruleType, threshold);
+			}
+
+			if (added) {
+
+				cout << "Anomaly rule successfully added.";
+				return true;
+			}
+
+			cout << "Invalid anomaly rule. Use above, below, rate or zscore with a threshold, rate and zscore thresholds must be greater than 0";
+			return false;
+		}
+
+		void clearAnomalyRules() {
+
+			{
+				lock_guard<mutex> lock(this->detectorMutex);
+				this->anomalyDetector.clearRules();
+			}
+			cout << "Anomaly rules cleared.";
+		}
+
+		size_t getAnomalyRuleCount() {
+
+			lock_guard<mutex> lock(this->detectorMutex);
+			return this->anomalyDetector.getRules().size();
+		}
+
+		AnomalyDetector& getAnomalyDetector() {
+
+			return this->anomalyDetector;
+		}
+
+		// newCount is the number of samples at the end of data that were not part of an earlier batch. Sensor::collectData
+		// returns the sliding buffer, so consecutive batches overlap and only the new samples feed the sketches and the
+		// spectrum, which therefore sees the sensor's own sample rate. The anomaly rules run on the filtered values the
+		// new samples produced.
+		void inputData(vector<dataType> data, size_t newCount = SIZE_MAX) {
+
+			newCount = min(newCount, data.size());
+			vector<dataType> newData(data.end() - newCount, data.end());
+
+			this->latestInputCount = newCount;
 			assignRawData(checkRawDataStatus(), data);
 			filterData();
+			updateSketches(newData);
+			{
+				lock_guard<mutex> lock(this->spectrumMutex);
+				this->spectralAnalyzer.addSamples(newData);
+			}
+
+			uint64_t timestampNs = currentTimestampNs();
+			lock_guard<mutex> lock(this->detectorMutex);
+			this->anomalyDetector.evaluate(getLatestFilteredData(), timestampNs);
+		}
+
+		// Approximate percentile of the last one to two windows of raw data, q in [0, 1]
+		double getRawPercentile(double q) {
+
+			lock_guard<mutex> lock(this->sketchMutex);
+			return mergeSketches(this->rawSketches).getQuantile(q);
+		}
+
+		double getFilteredPercentile(double q) {
+
+			lock_guard<mutex> lock(this->sketchMutex);
+			return mergeSketches(this->filteredSketches).getQuantile(q);
+		}
+
+		size_t getSketchBucketCount() {
+
+			lock_guard<mutex> lock(this->sketchMutex);
+			return this->rawSketches[0].getBucketCount() + this->rawSketches[1].getBucketCount()
+				+ this->filteredSketches[0].getBucketCount() + this->filteredSketches[1].getBucketCount();
 		}
 
 		void calculateSubsetAverages(int subsetSize) {
@@ -116,17 +288,122 @@ class DataProcessor {
 			return this->filteredData;
 		}
 
+		// Filtered values produced by the last inputData call
+		vector<double> getLatestFilteredData() {
+
+			size_t count = min(this->latestFilteredCount, this->filteredData.size());
+			return vector<double>(this->filteredData.end() - count, this->filteredData.end());
+		}
+
 		vector<double> getSubsetAverages() {
 
 			return this->subsetAverages;
 		}
 
+		// Reallocate the windows, sketches, anomaly window and spectrum buffers from the calling thread. Pages are placed
+		// on the NUMA node of the thread that first writes them, so the processing thread calls this after it was pinned.
+		void localizeBuffers() {
+
+			localizeVector(this->rawData);
+
+			// One spare slot, the moving average filter appends before it erases the oldest value
+			localizeVector(this->filteredData, 1);
+
+			{
+				lock_guard<mutex> lock(this->sketchMutex);
+				for (int i = 0; i < 2; i++) {
+
+					this->rawSketches[i].localizeBuffers();
+					this->filteredSketches[i].localizeBuffers();
+				}
+			}
+
+			{
+				lock_guard<mutex> lock(this->detectorMutex);
+				this->anomalyDetector.localizeBuffers();
+			}
+
+			lock_guard<mutex> lock(this->spectrumMutex);
+			this->spectralAnalyzer.localizeBuffers();
+		}
+
 	private:
 
+		friend struct DataProcessorProbe<dataType>;
+
 		// Fill rawData with zeros rawDataSize times
 		vector<dataType> rawData = vector<dataType>(rawDataSize, 0);
 		vector<double> filteredData = vector<double>(rawDataSize, 0); // This vector type should be double to store the average values
 		vector<double> subsetAverages; // This vector type should be double to store the average values
+		size_t latestInputCount = 0;
+		size_t latestFilteredCount = 0;
+
+		// Percentile sketches are rotated every rawDataSize samples: [0] is the current generation, [1] the previous one
+		QuantileSketch rawSketches[2];
+		QuantileSketch filteredSketches[2];
+		mutex sketchMutex; // The command thread reconfigures the sketches while the processing thread adds to them
+
+		AnomalyDetector anomalyDetector = AnomalyDetector(rawDataSize);
+		mutex detectorMutex; // The command thread changes the rules while the processing thread evaluates them
+		SpectralAnalyzer spectralAnalyzer = SpectralAnalyzer(spectrumSize, spectrumSize / 2);
+		mutex spectrumMutex; // The command thread reallocates the spectrum buffers while the processing thread adds samples
+
+		void configureSketches() {
+
+			lock_guard<mutex> lock(this->sketchMutex);
+			for (int i = 0; i < 2; i++) {
+
+				this->rawSketches[i].configure(this->sketchAccuracy / 100.0, this->sketchMaxBuckets);
+				this->filteredSketches[i].configure(this->sketchAccuracy / 100.0, this->sketchMaxBuckets);
+			}
+		}
+
+		void configureSpectrum() {
+
+			size_t hop = max<size_t>(this->spectrumSize * (100 - this->spectrumOverlap) / 100, 1);
+			lock_guard<mutex> lock(this->spectrumMutex);
+			this->spectralAnalyzer.configure(this->spectrumSize, hop);
+		}
+
+		void addToSketch(QuantileSketch (&sketches)[2], double value) {
+
+			if (sketches[0].getCount() >= static_cast<uint64_t>(this->rawDataSize)) {
+
+				sketches[1] = sketches[0];
+				sketches[0].clear();
+			}
+
+			sketches[0].add(value);
+		}
+
+		QuantileSketch mergeSketches(const QuantileSketch (&sketches)[2]) {
+
+			QuantileSketch merged = sketches[1];
+			merged.merge(sketches[0]);
+			return merged;
+		}
+
+		void updateSketches(const vector<dataType>& data) {
+
+			lock_guard<mutex> lock(this->sketchMutex);
+
+			for (const dataType& value : data) {
+
+				addToSketch(this->rawSketches, value);
+			}
+
+			if (this->filterType == 0) {
+
+				for (const dataType& value : data) {
+
+					addToSketch(this->filteredSketches, value);
+				}
+			}
+			else if (!this->filteredData.empty()) {
+
+				addToSketch(this->filteredSketches, this->filteredData.back());
+			}
+		}
 
 
 		int checkRawDataStatus() {
@@ -159,10 +436,9 @@ class DataProcessor {
 
 				if (data.size() < rawDataSize) {
 
-					// If data size is smaller than rawDataSize, erase the first rawDataSize - data.size() elements of rawData and insert the data to the end
-					this->rawData.erase(this->rawData.end() - (data.size() - 1), this->rawData.end());
+					// If data size is smaller than rawDataSize, erase the first data.size() elements of rawData and insert the data to the end
+					this->rawData.erase(this->rawData.begin(), this->rawData.begin() + data.size());
 					this->rawData.insert(this->rawData.end(), data.begin(), data.end());
-					this->rawData.erase(this->rawData.begin());
 					return;
 
 				}
@@ -231,12 +507,14 @@ class DataProcessor {
 			{
 			case 0: // No filter
 
+				this->latestFilteredCount = min(this->latestInputCount, this->rawData.size());
 				this->filteredData.clear();
 				this->filteredData = vector<double>(this->rawData.begin(), this->rawData.end());
 				break;
 
 			case 1: // Moving average filter
 
+				this->latestFilteredCount = this->rawData.size() < this->filterSize ? 0 : 1;
 				movingAverageFilter();
 				break;
 
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <bit>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+#define PUBLISHER_FRAME_MAGIC 0x53445046 // "SDPF"
+#define PUBLISHER_FRAME_VERSION 1
+
+#define FRAME_RAW 1
+#define FRAME_FILTERED 2
+#define FRAME_STATISTICS 3
+#define FRAME_ANOMALY 4
+
+// Every frame is a fixed header followed by count doubles, all fields are little-endian on the wire
+#pragma pack(push, 1)
+struct PublisherFrameHeader {
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;      // FRAME_RAW, FRAME_FILTERED, FRAME_STATISTICS or FRAME_ANOMALY
+    uint32_t sequence;
+    uint32_t count;     // Number of doubles in the payload
+    uint64_t timestampNs;
+};
+#pragma pack(pop)
+
+// Order of the values in a FRAME_STATISTICS payload
+#define STATISTICS_FIELD_COUNT 12
+inline const char* const statisticsFieldNames[STATISTICS_FIELD_COUNT] = {
+    "rawMin", "rawMax", "rawAverage", "rawP50", "rawP95", "rawP99",
+    "filteredMin", "filteredMax", "filteredAverage", "filteredP50", "filteredP95", "filteredP99"
+};
+
+// Values of one event in a FRAME_ANOMALY payload, which holds count / ANOMALY_FIELD_COUNT events
+#define ANOMALY_FIELD_COUNT 4
+inline const char* const anomalyFieldNames[ANOMALY_FIELD_COUNT] = { "sampleIndex", "rule", "threshold", "value" };
+
+// Wire encoding of the frames, shared by the publisher and its subscribers
+class PublisherFraming {
+
+    private:
+
+        template<typename T>
+        static void append(vector<char>& out, T value) {
+
+            char bytes[sizeof(T)];
+            memcpy(bytes, &value, sizeof(T));
+            if constexpr (endian::native == endian::big) reverse(bytes, bytes + sizeof(T));
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        template<typename T>
+        static T read(const char*& in) {
+
+            char bytes[sizeof(T)];
+            memcpy(bytes, in, sizeof(T));
+            if constexpr (endian::native == endian::big) reverse(bytes, bytes + sizeof(T));
+            in += sizeof(T);
+
+            T value;
+            memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+    public:
+
+        template<typename T>
+        static void encodeFrame(vector<char>& out, const PublisherFrameHeader& header, const vector<T>& values) {
+
+            append(out, header.magic);
+            append(out, header.version);
+            append(out, header.type);
+            append(out, header.sequence);
+            append(out, header.count);
+            append(out, header.timestampNs);
+
+            for (const T& value : values) {
+
+                append(out, static_cast<double>(value));
+            }
+        }
+
+        // in holds sizeof(PublisherFrameHeader) bytes
+        static PublisherFrameHeader decodeHeader(const char* in) {
+
+            PublisherFrameHeader header;
+            header.magic = read<uint32_t>(in);
+            header.version = read<uint16_t>(in);
+            header.type = read<uint16_t>(in);
+            header.sequence = read<uint32_t>(in);
+            header.count = read<uint32_t>(in);
+            header.timestampNs = read<uint64_t>(in);
+            return header;
+        }
+
+        // in holds count * sizeof(double) bytes
+        static void decodeValues(const char* in, uint32_t count, vector<double>& values) {
+
+            values.resize(count);
+            for (double& value : values) {
+
+                value = read<double>(in);
+            }
+        }
+};
+
+// Streams processed data to local subscribers over a Unix domain socket. publish() only encodes the frame
+// and queues it, a background thread batches the queued frames and writes them with non-blocking sends.
+// A subscriber whose outgoing buffer is full loses whole batches instead of stalling the pipeline. Dropped frames
+// still consume a sequence number, subscribers see every loss as a gap.
+class DataPublisher {
+
+    private:
+
+        struct Subscriber {
+
+            int fd = -1;
+            vector<char> outbox;
+            size_t sentBytes = 0;
+        };
+
+        mutex queueMutex;
+        condition_variable queueCondition;
+        vector<char> queuedFrames;
+        uint64_t queuedFrameCount = 0;
+        atomic<bool> active{ false };
+        thread worker;
+        string socketPath;
+        int listenFd = -1;
+        vector<Subscriber> subscribers;
+        uint32_t sequence = 0;
+
+        atomic<uint64_t> framesPublished{ 0 };
+        atomic<uint64_t> framesDropped{ 0 };
+        atomic<size_t> subscriberCount{ 0 };
+
+        static uint64_t currentTimestampNs() {
+
+            return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count());
+        }
+
+#ifndef _WIN32
+        void acceptSubscribers() {
+
+            while (true) {
+
+                int fd = accept(this->listenFd, nullptr, nullptr);
+                if (fd < 0) return;
+
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                Subscriber subscriber;
+                subscriber.fd = fd;
+                this->subscribers.push_back(move(subscriber));
+            }
+        }
+
+        // Returns false if the subscriber disconnected
+        bool flushSubscriber(Subscriber& subscriber) {
+
+            while (subscriber.sentBytes < subscriber.outbox.size()) {
+
+                ssize_t sent = send(subscriber.fd, subscriber.outbox.data() + subscriber.sentBytes,
+                    subscriber.outbox.size() - subscriber.sentBytes, MSG_NOSIGNAL);
+
+                if (sent < 0) {
+
+                    return errno == EAGAIN || errno == EWOULDBLOCK;
+                }
+
+                subscriber.sentBytes += sent;
+            }
+
+            subscriber.outbox.clear();
+            subscriber.sentBytes = 0;
+            return true;
+        }
+
+        void publishTask() {
+
+            vector<char> batch;
+            uint64_t batchFrames = 0;
+
+            while (this->active) {
+
+                {
+                    unique_lock<mutex> lock(this->queueMutex);
+                    this->queueCondition.wait_for(lock, chrono::milliseconds(this->batchInterval), [this] { return !this->active; });
+                    batch.swap(this->queuedFrames);
+                    batchFrames = this->queuedFrameCount;
+                    this->queuedFrameCount = 0;
+                }
+
+                acceptSubscribers();
+
+                for (size_t i = 0; i < this->subscribers.size();) {
+
+                    Subscriber& subscriber = this->subscribers[i];
+
+                    if (!batch.empty()) {
+
+                        if (subscriber.outbox.size() + batch.size() <= this->maxSubscriberBacklog) {
+
+                            subscriber.outbox.insert(subscriber.outbox.end(), batch.begin(), batch.end());
+                        }
+                        else {
+
+                            this->framesDropped += batchFrames;
+                        }
+                    }
+
+                    if (!flushSubscriber(subscriber)) {
+
+                        close(subscriber.fd);
+                        this->subscribers.erase(this->subscribers.begin() + i);
+                        continue;
+                    }
+
+                    i++;
+                }
+
+                this->subscriberCount = this->subscribers.size();
+                batch.clear();
+            }
+        }
+#endif
+
+    public:
+
+        int batchInterval = 5;                          // Milliseconds between two batched writes
+        size_t maxQueuedBytes = 1 << 20;                // Frames queued by publish() before new frames are dropped
+        size_t maxSubscriberBacklog = 4 << 20;          // Unsent bytes kept per subscriber before batches are dropped
+
+        // framesDropped counts frames: once per frame dropped at the queue and once per frame and subscriber in a dropped batch
+
+        ~DataPublisher() {
+
+            stop();
+        }
+
+        bool start(const string& path) {
+
+#ifdef _WIN32
+            cout << "Data publishing is only supported on POSIX systems.";
+            return false;
+#else
+            if (this->active) return true;
+
+            this->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (this->listenFd < 0) {
+
+                cout << "Data publisher could not create socket.";
+                return false;
+            }
+
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+            unlink(path.c_str());
+
+            if (bind(this->listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(this->listenFd, 16) < 0) {
+
+                cout << "Data publisher could not bind " << path;
+                close(this->listenFd);
+                this->listenFd = -1;
+                return false;
+            }
+
+            fcntl(this->listenFd, F_SETFL, fcntl(this->listenFd, F_GETFL) | O_NONBLOCK);
+            this->socketPath = path;
+            this->active = true;
+            this->worker = thread(&DataPublisher::publishTask, this);
+            return true;
+#endif
+        }
+
+        void stop() {
+
+#ifndef _WIN32
+            if (!this->active) return;
+
+            this->active = false;
+            this->queueCondition.notify_all();
+            if (this->worker.joinable()) this->worker.join();
+
+            // Frames queued after the worker's last batch belong to this session, they are dropped instead of
+            // leading the next one with old sequence numbers
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+                this->framesDropped += this->queuedFrameCount;
+                this->queuedFrames.clear();
+                this->queuedFrameCount = 0;
+            }
+
+            for (Subscriber& subscriber : this->subscribers) {
+
+                close(subscriber.fd);
+            }
+
+            this->subscribers.clear();
+            this->subscriberCount = 0;
+            close(this->listenFd);
+            this->listenFd = -1;
+            unlink(this->socketPath.c_str());
+#endif
+        }
+
+        template<typename T>
+        void publish(uint16_t type, const vector<T>& values) {
+
+            if (!this->active || values.empty()) return;
+
+            PublisherFrameHeader header{};
+            header.magic = PUBLISHER_FRAME_MAGIC;
+            header.version = PUBLISHER_FRAME_VERSION;
+            header.type = type;
+            header.count = static_cast<uint32_t>(values.size());
+            header.timestampNs = currentTimestampNs();
+
+            lock_guard<mutex> lock(this->queueMutex);
+
+            // Numbered before the drop check, so that a frame dropped here is a gap for the subscribers
+            header.sequence = this->sequence++;
+
+            size_t frameSize = sizeof(header) + values.size() * sizeof(double);
+            if (this->queuedFrames.size() + frameSize > this->maxQueuedBytes) {
+
+                this->framesDropped++;
+                return;
+            }
+
+            PublisherFraming::encodeFrame(this->queuedFrames, header, values);
+            this->queuedFrameCount++;
+            this->framesPublished++;
+        }
+
+        bool isActive() {
+
+            return this->active;
+        }
+
+        string getSocketPath() {
+
+            return this->socketPath;
+        }
+
+        size_t getSubscriberCount() {
+
+            return this->subscriberCount;
+        }
+
+        uint64_t getFramesPublished() {
+
+            return this->framesPublished;
+        }
+
+        uint64_t getFramesDropped() {
+
+            return this->framesDropped;
+        }
+};
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <climits>
+
+#include "ThreadPlacement.cpp"
+
+using namespace std;
+
+class PipelineExecutor;
+
+// Shared cancellation flag of one pipeline. Cancelling also wakes the pipeline's sleeping stages early.
+class CancellationToken {
+
+    private:
+
+        shared_ptr<atomic<bool>> cancelled = make_shared<atomic<bool>>(false);
+
+    public:
+
+        bool isCancelled() const {
+
+            return *this->cancelled;
+        }
+
+        void cancel() {
+
+            *this->cancelled = true;
+        }
+
+        bool operator==(const CancellationToken& other) const {
+
+            return this->cancelled == other.cancelled;
+        }
+};
+
+// Fire-and-forget coroutine started with PipelineExecutor::spawn. The frame is destroyed when the coroutine
+// finishes and the executor counts it as finished.
+struct PipelineTask {
+
+    struct promise_type {
+
+        PipelineExecutor* executor = nullptr;
+
+        PipelineTask get_return_object() {
+
+            return PipelineTask{ coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        suspend_always initial_suspend() noexcept {
+
+            return {};
+        }
+
+        struct FinalAwaiter {
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(coroutine_handle<promise_type> handle) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept {
+
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+
+            terminate();
+        }
+    };
+
+    coroutine_handle<promise_type> handle;
+};
+
+// Runs coroutines on a small pool of worker threads. Suspended coroutines cost no thread, so thousands
+// of pipeline stages can share a few workers. Sleeping coroutines wait in a timer heap instead of blocking.
+// With a placement every worker follows its CPU and scheduling settings before it resumes a coroutine.
+class PipelineExecutor {
+
+    private:
+
+        struct Timer {
+
+            chrono::steady_clock::time_point time;
+            uint64_t sequence;
+            coroutine_handle<> handle;
+            CancellationToken token;
+
+            bool operator>(const Timer& other) const {
+
+                return time != other.time ? time > other.time : sequence > other.sequence;
+            }
+        };
+
+        mutex queueMutex;
+        condition_variable queueCondition;
+        condition_variable idleCondition;
+        deque<coroutine_handle<>> ready;
+        vector<Timer> timers; // Min-heap on time
+        uint64_t timerSequence = 0;
+        vector<thread> workers;
+        bool stopping = false;
+        size_t activeTasks = 0;
+        ThreadPlacement* placement = nullptr;
+
+        void workerTask() {
+
+            unsigned int appliedVersion = UINT_MAX;
+            if (this->placement) this->placement->applyIfChanged(appliedVersion);
+
+            unique_lock<mutex> lock(this->queueMutex);
+
+            while (!this->stopping) {
+
+                auto now = chrono::steady_clock::now();
+                while (!this->timers.empty() && this->timers.front().time <= now) {
+
+                    pop_heap(this->timers.begin(), this->timers.end(), greater<Timer>());
+                    this->ready.push_back(this->timers.back().handle);
+                    this->timers.pop_back();
+                }
+
+                if (!this->ready.empty()) {
+
+                    coroutine_handle<> handle = this->ready.front();
+                    this->ready.pop_front();
+
+                    lock.unlock();
+                    if (this->placement) this->placement->applyIfChanged(appliedVersion);
+                    handle.resume();
+                    lock.lock();
+                    continue;
+                }
+
+                if (this->timers.empty()) {
+
+                    this->queueCondition.wait(lock);
+                }
+                else {
+
+                    this->queueCondition.wait_until(lock, this->timers.front().time);
+                }
+            }
+        }
+
+    public:
+
+        ~PipelineExecutor() {
+
+            stop();
+        }
+
+        void start(int threadCount, ThreadPlacement* placement = nullptr) {
+
+            lock_guard<mutex> lock(this->queueMutex);
+            if (!this->workers.empty()) return;
+
+            this->stopping = false;
+            this->placement = placement;
+            for (int i = 0; i < max(threadCount, 1); i++) {
+
+                this->workers.emplace_back(&PipelineExecutor::workerTask, this);
+            }
+        }
+
+        // Stop the workers, pipelines should be cancelled and drained first
+        void stop() {
+
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+                this->stopping = true;
+            }
+
+            this->queueCondition.notify_all();
+            for (thread& worker : this->workers) {
+
+                worker.join();
+            }
+
+            this->workers.clear();
+        }
+
+        // Placement of the workers, nullptr when they run unpinned
+        ThreadPlacement* getPlacement() {
+
+            return this->placement;
+        }
+
+        bool isRunning() {
+
+            lock_guard<mutex> lock(this->queueMutex);
+            return !this->workers.empty();
+        }
+
+        void spawn(PipelineTask task) {
+
+            task.handle.promise().executor = this;
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+                this->activeTasks++;
+            }
+            schedule(task.handle);
+        }
+
+        void schedule(coroutine_handle<> handle) {
+
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+                this->ready.push_back(handle);
+            }
+            this->queueCondition.notify_one();
+        }
+
+        void scheduleAfter(int delayMs, coroutine_handle<> handle, const CancellationToken& token) {
+
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+
+                // A pipeline cancelled after the sleeper checked its token may already have been woken by wakeCancelled,
+                // checking again under the lock keeps its timer from waiting out the whole delay
+                auto time = token.isCancelled() ? chrono::steady_clock::time_point::min() : chrono::steady_clock::now() + chrono::milliseconds(delayMs);
+                this->timers.push_back({ time, this->timerSequence++, handle, token });
+                push_heap(this->timers.begin(), this->timers.end(), greater<Timer>());
+            }
+            this->queueCondition.notify_one();
+        }
+
+        // Resume the sleeping coroutines of a cancelled pipeline immediately
+        void wakeCancelled(const CancellationToken& token) {
+
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+                for (Timer& timer : this->timers) {
+
+                    if (timer.token == token) timer.time = chrono::steady_clock::time_point::min();
+                }
+                make_heap(this->timers.begin(), this->timers.end(), greater<Timer>());
+            }
+            this->queueCondition.notify_all();
+        }
+
+        void taskFinished() {
+
+            {
+                lock_guard<mutex> lock(this->queueMutex);
+                this->activeTasks--;
+            }
+            this->idleCondition.notify_all();
+        }
+
+        // Wait until every spawned coroutine has finished
+        void waitIdle() {
+
+            unique_lock<mutex> lock(this->queueMutex);
+            this->idleCondition.wait(lock, [this] { return this->activeTasks == 0; });
+        }
+
+        // co_await executor.sleepFor(ms, token) suspends the coroutine without blocking a worker
+        auto sleepFor(int delayMs, const CancellationToken& token) {
+
+            struct SleepAwaiter {
+
+                PipelineExecutor& executor;
+                int delayMs;
+                CancellationToken token;
+
+                bool await_ready() { return this->delayMs <= 0 || this->token.isCancelled(); }
+                void await_suspend(coroutine_handle<> handle) { this->executor.scheduleAfter(this->delayMs, handle, this->token); }
+                void await_resume() {}
+            };
+
+            return SleepAwaiter{ *this, delayMs, token };
+        }
+};
+
+inline void PipelineTask::promise_type::FinalAwaiter::await_suspend(coroutine_handle<promise_type> handle) noexcept {
+
+    PipelineExecutor* executor = handle.promise().executor;
+    handle.destroy();
+    executor->taskFinished();
+}
+
+// Bounded channel between two pipeline stages. A full channel suspends the sender and an empty one the
+// receiver, so a slow stage applies backpressure upstream. After close() receivers drain the remaining
+// items and then get an empty optional, and senders get false.
+template<typename T>
+class Channel {
+
+    private:
+
+        struct SendAwaiter;
+        struct ReceiveAwaiter;
+
+        PipelineExecutor& executor;
+        size_t capacity;
+        mutex channelMutex;
+        deque<T> items;
+        deque<SendAwaiter*> waitingSenders;
+        deque<ReceiveAwaiter*> waitingReceivers;
+        bool closed = false;
+
+        struct SendAwaiter {
+
+            Channel& channel;
+            T value;
+            bool sent = false;
+            coroutine_handle<> handle;
+
+            bool await_ready() { return false; }
+
+            bool await_suspend(coroutine_handle<> handle) {
+
+                lock_guard<mutex> lock(this->channel.channelMutex);
+                if (this->channel.closed) return false;
+
+                if (!this->channel.waitingReceivers.empty()) {
+
+                    // Hand the value straight to a waiting receiver
+                    ReceiveAwaiter* receiver = this->channel.waitingReceivers.front();
+                    this->channel.waitingReceivers.pop_front();
+                    receiver->result = move(this->value);
+                    this->sent = true;
+                    this->channel.executor.schedule(receiver->handle);
+                    return false;
+                }
+
+                if (this->channel.items.size() < this->channel.capacity) {
+
+                    this->channel.items.push_back(move(this->value));
+                    this->sent = true;
+                    return false;
+                }
+
+                this->handle = handle;
+                this->channel.waitingSenders.push_back(this);
+                return true;
+            }
+
+            bool await_resume() { return this->sent; }
+        };
+
+        struct ReceiveAwaiter {
+
+            Channel& channel;
+            optional<T> result;
+            coroutine_handle<> handle;
+
+            bool await_ready() { return false; }
+
+            bool await_suspend(coroutine_handle<> handle) {
+
+                lock_guard<mutex> lock(this->channel.channelMutex);
+
+                if (!this->channel.items.empty()) {
+
+                    this->result = move(this->channel.items.front());
+                    this->channel.items.pop_front();
+
+                    // A slot became free, admit one waiting sender
+                    if (!this->channel.waitingSenders.empty()) {
+
+                        SendAwaiter* sender = this->channel.waitingSenders.front();
+                        this->channel.waitingSenders.pop_front();
+                        this->channel.items.push_back(move(sender->value));
+                        sender->sent = true;
+                        this->channel.executor.schedule(sender->handle);
+                    }
+                    return false;
+                }
+
+                if (this->channel.closed) return false;
+
+                this->handle = handle;
+                this->channel.waitingReceivers.push_back(this);
+                return true;
+            }
+
+            optional<T> await_resume() { return move(this->result); }
+        };
+
+    public:
+
+        Channel(PipelineExecutor& executor, size_t capacity) : executor(executor), capacity(max<size_t>(capacity, 1)) {}
+
+        SendAwaiter send(T value) {
+
+            return SendAwaiter{ *this, move(value), false, nullptr };
+        }
+
+        ReceiveAwaiter receive() {
+
+            return ReceiveAwaiter{ *this, nullopt, nullptr };
+        }
+
+        void close() {
+
+            lock_guard<mutex> lock(this->channelMutex);
+            this->closed = true;
+
+            for (SendAwaiter* sender : this->waitingSenders) {
+
+                this->executor.schedule(sender->handle);
+            }
+
+            for (ReceiveAwaiter* receiver : this->waitingReceivers) {
+
+                this->executor.schedule(receiver->handle);
+            }
+
+            this->waitingSenders.clear();
+            this->waitingReceivers.clear();
+        }
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "ThreadPlacement.cpp"
+
+using namespace std;
+
+// Relative-error quantile sketch (DDSketch). Every value is mapped to a logarithmic bucket so that any
+// reported quantile is within relativeAccuracy of the true value. Two sketches with the same accuracy
+// can be merged by adding their bucket counts, which lets windows and sensors be combined cheaply.
+class QuantileSketch {
+
+    private:
+
+        // Dense bucket store, counts[i] holds the bucket with index (minIndex + i)
+        struct BucketStore {
+
+            vector<uint64_t> counts;
+            int minIndex = 0;
+            uint64_t total = 0;
+
+            void add(int index, uint64_t count, size_t maxBuckets) {
+
+                if (this->counts.empty()) {
+
+                    this->counts.assign(1, 0);
+                    this->minIndex = index;
+                }
+
+                if (index < this->minIndex) {
+
+                    // Once the store is at its memory limit, the lowest buckets are collapsed together
+                    if (this->counts.size() >= maxBuckets) {
+
+                        index = this->minIndex;
+                    }
+                    else {
+
+                        size_t grow = min(static_cast<size_t>(this->minIndex - index), maxBuckets - this->counts.size());
+                        this->counts.insert(this->counts.begin(), grow, 0);
+                        this->minIndex -= static_cast<int>(grow);
+                        index = max(index, this->minIndex);
+                    }
+                }
+
+                int maxIndex = this->minIndex + static_cast<int>(this->counts.size()) - 1;
+                if (index > maxIndex) {
+
+                    this->counts.resize(this->counts.size() + (index - maxIndex), 0);
+                    collapse(maxBuckets);
+                }
+
+                this->counts[index - this->minIndex] += count;
+                this->total += count;
+            }
+
+            void collapse(size_t maxBuckets) {
+
+                if (this->counts.size() <= maxBuckets) return;
+
+                size_t excess = this->counts.size() - maxBuckets;
+                uint64_t collapsed = 0;
+                for (size_t i = 0; i <= excess; i++) {
+
+                    collapsed += this->counts[i];
+                }
+
+                this->counts.erase(this->counts.begin(), this->counts.begin() + excess);
+                this->counts[0] = collapsed;
+                this->minIndex += static_cast<int>(excess);
+            }
+
+            void merge(const BucketStore& other, size_t maxBuckets) {
+
+                for (size_t i = 0; i < other.counts.size(); i++) {
+
+                    if (other.counts[i] > 0) {
+
+                        add(other.minIndex + static_cast<int>(i), other.counts[i], maxBuckets);
+                    }
+                }
+            }
+
+            void clear() {
+
+                this->counts.clear();
+                this->minIndex = 0;
+                this->total = 0;
+            }
+        };
+
+        BucketStore positive;
+        BucketStore negative;
+        uint64_t zeroCount = 0;
+        uint64_t count = 0;
+
+        double relativeAccuracy = 0.01;
+        size_t maxBuckets = 2048;
+        double gamma = 1.0;
+        double logGamma = 1.0;
+        double minIndexableValue = 1e-9;
+
+        int bucketIndex(double value) const {
+
+            return static_cast<int>(ceil(log(value) / this->logGamma));
+        }
+
+        double bucketValue(int index) const {
+
+            return 2.0 * pow(this->gamma, index) / (this->gamma + 1.0);
+        }
+
+    public:
+
+        QuantileSketch(double relativeAccuracy = 0.01, size_t maxBuckets = 2048) {
+
+            configure(relativeAccuracy, maxBuckets);
+        }
+
+        // Reallocate the bucket counts from the calling thread, see ThreadPlacement
+        void localizeBuffers() {
+
+            localizeVector(this->positive.counts);
+            localizeVector(this->negative.counts);
+        }
+
+        // Changing the accuracy changes the bucket mapping, so the sketch is cleared
+        void configure(double relativeAccuracy, size_t maxBuckets) {
+
+            this->relativeAccuracy = relativeAccuracy;
+            this->maxBuckets = max<size_t>(maxBuckets, 1);
+            this->gamma = (1.0 + relativeAccuracy) / (1.0 - relativeAccuracy);
+            this->logGamma = log(this->gamma);
+            clear();
+        }
+
+        void add(double value) {
+
+            if (value > this->minIndexableValue) {
+
+                this->positive.add(bucketIndex(value), 1, this->maxBuckets);
+            }
+            else if (value < -this->minIndexableValue) {
+
+                this->negative.add(bucketIndex(-value), 1, this->maxBuckets);
+            }
+            else {
+
+                this->zeroCount++;
+            }
+
+            this->count++;
+        }
+
+        template<typename T>
+        void addAll(const vector<T>& values) {
+
+            for (const T& value : values) {
+
+                add(static_cast<double>(value));
+            }
+        }
+
+        // Both sketches must share the same relative accuracy
+        bool merge(const QuantileSketch& other) {
+
+            if (other.relativeAccuracy != this->relativeAccuracy) return false;
+
+            this->positive.merge(other.positive, this->maxBuckets);
+            this->negative.merge(other.negative, this->maxBuckets);
+            this->zeroCount += other.zeroCount;
+            this->count += other.count;
+            return true;
+        }
+
+        double getQuantile(double q) const {
+
+            if (this->count == 0 || q < 0.0 || q > 1.0) return 0.0;
+
+            uint64_t rank = static_cast<uint64_t>(q * (this->count - 1));
+            uint64_t seen = 0;
+
+            // Most negative values first, they live in the highest negative buckets
+            for (size_t i = this->negative.counts.size(); i-- > 0;) {
+
+                seen += this->negative.counts[i];
+                if (seen > rank) return -bucketValue(this->negative.minIndex + static_cast<int>(i));
+            }
+
+            seen += this->zeroCount;
+            if (seen > rank) return 0.0;
+
+            for (size_t i = 0; i < this->positive.counts.size(); i++) {
+
+                seen += this->positive.counts[i];
+                if (seen > rank) return bucketValue(this->positive.minIndex + static_cast<int>(i));
+            }
+
+            return 0.0;
+        }
+
+        void clear() {
+
+            this->positive.clear();
+            this->negative.clear();
+            this->zeroCount = 0;
+            this->count = 0;
+        }
+
+        uint64_t getCount() const {
+
+            return this->count;
+        }
+
+        size_t getBucketCount() const {
+
+            return this->positive.counts.size() + this->negative.counts.size();
+        }
+
+        double getRelativeAccuracy() const {
+
+            return this->relativeAccuracy;
+        }
+
+        size_t getMaxBuckets() const {
+
+            return this->maxBuckets;
+        }
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <vector>
 #include <thread>
 #include <mutex>
@@ -6,9 +8,20 @@
 #include <chrono>
 #include <string>
 #include <ctime>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <stop_token>
+#include <condition_variable>
+
+#include "ShmRing.cpp"
+#include "ThreadPlacement.cpp"
+#include "SignalSynthesizer.cpp"
+#include "SimulationClock.cpp"
 
 #define PERIODICALLY 1
 #define DETERMINISTIC 1
+#define SYNTHESIZED 2
 #define UNBOUNDED 1
 #define ASYNCHRONOUS 0
 #define RANGE 0
@@ -23,7 +36,47 @@ class Sensor {
 
         mutex bufferMutex;
         vector<dataType> dataBuffer;
+        vector<int64_t> timestampBuffer;        // Generation time of every buffered sample
+        vector<int64_t> collectedTimestamps;    // Generation times of the last collectData batch
         bool dataReady = false;
+        ShmRing* ring = nullptr;
+
+        // Generation thread ownership. The thread is stopped through its stop token and joined, never detached.
+        jthread generationThread;
+        mutex lifecycleMutex;
+        condition_variable_any lifecycleCondition; // Wakes the generation thread on pause, resume and stop
+        bool paused = false;
+
+        // Every sensor owns its generator so that a seed reproduces the same values and timing on every platform
+        mt19937 randomEngine{ 1 };
+        int deterministicStep = 0;
+        SignalSynthesizer synthesizer; // Value source of the SYNTHESIZED value type, guarded by bufferMutex
+        vector<double> signalBlock;     // Bulk output of the synthesizer, guarded by bufferMutex
+        vector<dataType> valueBlock;    // Values of the last generateBlock call, guarded by bufferMutex
+        atomic<uint64_t> generatedCount{ 0 };
+        uint64_t collectedCount = 0;    // generatedCount at the last collectData call
+        size_t newDataCount = 0;
+
+        // Uniform value in [0, 1], computed from the raw engine output because standard distributions differ between libraries
+        double randomUnit() {
+
+            return this->randomEngine() / static_cast<double>(mt19937::max());
+        }
+
+        // Uniform integer in [0, range), drawn by rejection from the raw engine output so that no value is favoured
+        uint32_t randomIndex(uint32_t range) {
+
+            // Largest multiple of range that fits the 32 bit engine output
+            uint64_t limit = (1ULL << 32) - (1ULL << 32) % range;
+            uint64_t value;
+
+            do {
+
+                value = this->randomEngine();
+            } while (value >= limit);
+
+            return static_cast<uint32_t>(value % range);
+        }
 
         dataType generateRandomDataPoint() {
 
@@ -31,12 +84,12 @@ class Sensor {
 
             case RANGE:
 
-                return this->lowerBound + static_cast <dataType> (rand()) / (static_cast <dataType> (RAND_MAX / (this->upperBound - (this->lowerBound))));
+                return this->lowerBound + static_cast<dataType>(randomUnit() * (this->upperBound - this->lowerBound));
                 break;
 
             case UNBOUNDED:
 
-                return static_cast<dataType>(rand()) / static_cast<dataType>(RAND_MAX) * static_cast<dataType>(2e6) - static_cast<dataType>(1e6);
+                return static_cast<dataType>(randomUnit() * 2e6 - 1e6);
                 break;
 
             default:
@@ -48,7 +101,7 @@ class Sensor {
         // Generate sawtooth wave data
         dataType generateDeterministicDataPoint() {
 
-            static int step = 0;
+            int& step = this->deterministicStep;
             int period = 100;
 
             switch (this->limit) {
@@ -78,46 +131,76 @@ class Sensor {
                 return this->generateRandomDataPoint();
             }
 
+            if (this->valueType == SYNTHESIZED) {
+
+                return boundSignal(this->synthesizer.next());
+            }
+
             return this->generateDeterministicDataPoint();
         }
 
+        // In range mode a synthesized value saturates at the bounds like a real sensor, unbounded it passes unchanged
+        dataType boundSignal(double value) {
 
-        void generateTask() {
+            if (this->limit == RANGE) value = min(max(value, static_cast<double>(this->lowerBound)), static_cast<double>(this->upperBound));
+            return static_cast<dataType>(value);
+        }
 
-            while (true) {
 
-                {
-                    lock_guard<mutex> lock(bufferMutex);
+        // Copy the buffer into an allocation written by the calling thread, so that its pages are local to the thread's NUMA node
+        void localizeBuffer() {
 
-                    dataType data = this->generateDataPoint();
+            lock_guard<mutex> lock(bufferMutex);
 
-                    // Check if the buffer is full, if it is full delete first element and shift the rest to the left then add the new data point
-                    if (this->dataBuffer.size() == this->dataBufferSize) {
+            vector<dataType> local;
+            local.reserve(max<size_t>(this->dataBufferSize, this->dataBuffer.size()));
+            local.assign(this->dataBuffer.begin(), this->dataBuffer.end());
+            this->dataBuffer.swap(local);
 
-                        this->dataBuffer.erase(this->dataBuffer.begin());
-                    }
+            vector<int64_t> timestamps;
+            timestamps.reserve(max<size_t>(this->dataBufferSize, this->timestampBuffer.size()));
+            timestamps.assign(this->timestampBuffer.begin(), this->timestampBuffer.end());
+            this->timestampBuffer.swap(timestamps);
+        }
 
-                    this->dataBuffer.push_back(data);
-                    this->dataReady = true;
-                }
+        void generateTask(stop_token token) {
+
+            this->placement.apply();
+            localizeBuffer();
+
+            unique_lock<mutex> lock(this->lifecycleMutex);
+
+            while (!token.stop_requested()) {
 
-                // Sleep for the period
-                if (this->timing == PERIODICALLY) {
+                if (this->paused) {
 
-                    this_thread::sleep_for(chrono::milliseconds(this->period));
+                    // Sleep until resumed or stopped
+                    this->lifecycleCondition.wait(lock, token, [this] { return !this->paused; });
+                    continue;
                 }
-                else {
 
-                    this_thread::sleep_for(chrono::milliseconds(rand() % (this->maxPeriod - this->minPeriod + 1) + this->minPeriod));
+                lock.unlock();
+
+                if (this->placement.applyIfChanged()) {
+
+                    localizeBuffer();
                 }
+
+                int delay = generateArrivals();
+
+                lock.lock();
+
+                // Sleep for the period, pause and stop end the sleep early
+                this->lifecycleCondition.wait_for(lock, token, chrono::milliseconds(delay), [this] { return this->paused; });
             }
         }
 
     public:
 
         /* Default data attributes */
+        unsigned int seed = 1;
         int timing = PERIODICALLY;  // 0 - Asynchronous, 1 - Periodically
-        int valueType = RANDOM;     // 0 - Random, 1 - Deterministic
+        int valueType = RANDOM;     // 0 - Random, 1 - Deterministic, 2 - Synthesized
         int limit = RANGE;          // 0 - Range, 1 - Unbounded
 
         int upperBound = 100;
@@ -128,7 +211,10 @@ class Sensor {
         int maxPeriod = 2000;       // Maximum period of 2 seconds
         int dataBufferSize = 5;
 
-        void setBufferSize(int n) {
+        ThreadPlacement placement;  // CPU and scheduling of the generation thread
+
+        // Returns false for a size that is not positive, the processor calls this on every poll so it prints nothing
+        bool setBufferSize(int n) {
 
             if (n > 0 && n != this->dataBufferSize) {
 
@@ -137,30 +223,233 @@ class Sensor {
                 if (n < this->dataBuffer.size()) {
 
                     this->dataBuffer.erase(this->dataBuffer.begin(), this->dataBuffer.begin() + (this->dataBuffer.size() - n));
+                    this->timestampBuffer.erase(this->timestampBuffer.begin(), this->timestampBuffer.begin() + (this->timestampBuffer.size() - n));
                 }
 
                 this->dataBufferSize = n;
-                return;
             }
+
+            return n > 0;
+        }
+
+        // Generate one data point into the buffer, used by the generation thread and by the virtual-time simulation
+        void generateOnce() {
+
+            generateBlock(1);
+        }
+
+        // Generate count data points that arrive together. A synthesized signal renders them with one bulk call,
+        // the buffer keeps the newest of them and every one is written to the shared memory ring.
+        void generateBlock(size_t count) {
+
+            lock_guard<mutex> lock(bufferMutex);
+
+            this->valueBlock.resize(count);
+
+            if (this->valueType == SYNTHESIZED) {
+
+                this->signalBlock.resize(count);
+                this->synthesizer.generate(this->signalBlock.data(), count);
+                for (size_t i = 0; i < count; i++) this->valueBlock[i] = boundSignal(this->signalBlock[i]);
+            }
+            else {
+
+                for (size_t i = 0; i < count; i++) this->valueBlock[i] = this->generateDataPoint();
+            }
+
+            // Only the newest dataBufferSize points fit, the oldest ones are deleted and the rest shift to the left
+            size_t kept = min<size_t>(count, this->dataBufferSize);
+            size_t total = this->dataBuffer.size() + kept;
+            size_t overflow = total > static_cast<size_t>(this->dataBufferSize) ? total - this->dataBufferSize : 0;
+
+            this->dataBuffer.erase(this->dataBuffer.begin(), this->dataBuffer.begin() + overflow);
+            this->timestampBuffer.erase(this->timestampBuffer.begin(), this->timestampBuffer.begin() + overflow);
+
+            this->dataBuffer.insert(this->dataBuffer.end(), this->valueBlock.end() - kept, this->valueBlock.end());
+            this->timestampBuffer.insert(this->timestampBuffer.end(), kept, currentTimestampNs());
+            this->dataReady = true;
+            this->generatedCount += count;
+
+            if (this->ring != nullptr) {
+
+                for (const dataType& value : this->valueBlock) this->ring->push(value);
+            }
+        }
+
+        // Generate the next arrival and return the delay after it. The samples of a burst have no delay between
+        // them, so the rest of the burst is generated with one generateBlock call.
+        int generateArrivals() {
+
+            // Random values and asynchronous delays share the engine, their order stays value first
+            if (this->valueType != SYNTHESIZED) {
+
+                generateOnce();
+                return nextDelay();
+            }
+
+            size_t count = 1;
+            int delay = nextDelay();
+
+            while (delay == 0) {
+
+                count++;
+                delay = nextDelay();
+            }
+
+            generateBlock(count);
+            return delay;
+        }
+
+        // Generate one data point without buffering it, used by the coroutine pipeline
+        dataType nextDataPoint() {
+
+            lock_guard<mutex> lock(bufferMutex);
+            this->generatedCount++;
+            return this->generateDataPoint();
+        }
+
+        // Milliseconds until the next data point, random between minPeriod and maxPeriod in asynchronous mode.
+        // The engine is shared with the values and reseeded by setSeed, so it is only used under bufferMutex.
+        int nextDelay() {
+
+            lock_guard<mutex> lock(bufferMutex);
+
+            int delay = this->period;
+
+            if (this->timing != PERIODICALLY) {
+
+                delay = this->minPeriod + static_cast<int>(randomIndex(static_cast<uint32_t>(this->maxPeriod - this->minPeriod + 1)));
+            }
+
+            // A synthesized signal can group its samples into bursts
+            if (this->valueType == SYNTHESIZED) {
+
+                return this->synthesizer.arrivalDelay(delay);
+            }
+
+            return delay;
+        }
+
+        // Restart the value and timing sequence from the given seed and clear buffered data
+        void setSeed(unsigned int seed) {
+
+            lock_guard<mutex> lock(bufferMutex);
+            this->seed = seed;
+            this->randomEngine.seed(seed);
+            this->deterministicStep = 0;
+            this->synthesizer.reset(seed);
+            this->dataBuffer.clear();
+            this->timestampBuffer.clear();
+            this->dataReady = false;
+            cout << "Sensor seed successfully set.";
         }
 
+        // Return the whole sliding buffer, so consecutive batches overlap. getNewDataCount tells how many of the
+        // returned samples were generated since the previous batch.
         vector<dataType> collectData(int n) {
 
 		    setBufferSize(n);
 
+            lock_guard<mutex> lock(bufferMutex);
+
             // Ensure the buffer is large enough before returning.
             if (dataBuffer.size() < n) {
 
                 return vector<dataType>(); // Return an empty vector if insufficient data.
             }
 
+            uint64_t generated = this->generatedCount;
+            this->newDataCount = static_cast<size_t>(min<uint64_t>(generated - this->collectedCount, dataBuffer.size()));
+            this->collectedCount = generated;
+            this->collectedTimestamps = this->timestampBuffer;
             return dataBuffer;
         }
 
+        // Generation times in ns since the epoch of the samples returned by the last collectData call
+        vector<int64_t> getCollectedTimestamps() {
+
+            lock_guard<mutex> lock(bufferMutex);
+            return this->collectedTimestamps;
+        }
+
+        // Number of samples at the end of the last collectData batch that no earlier batch contained
+        size_t getNewDataCount() {
+
+            lock_guard<mutex> lock(bufferMutex);
+            return this->newDataCount;
+        }
+
+        ~Sensor() {
+
+            stopGeneration();
+        }
+
+        // Start the generation thread, or resume it when it is paused. At most one generation thread runs per sensor.
         void startGeneration() {
 
-            thread t(&Sensor::generateTask, this);
-            t.detach(); // Detach the thread from the main thread
+            lock_guard<mutex> lock(this->lifecycleMutex);
+
+            if (this->generationThread.joinable()) {
+
+                this->paused = false;
+                this->lifecycleCondition.notify_all();
+                return;
+            }
+
+            this->paused = false;
+            this->generationThread = jthread([this](stop_token token) { generateTask(token); });
+        }
+
+        // Stop the generation thread and wait until it has exited, buffered data is kept
+        void stopGeneration() {
+
+            {
+                lock_guard<mutex> lock(this->lifecycleMutex);
+                if (!this->generationThread.joinable()) return;
+
+                this->generationThread.request_stop();
+            }
+
+            this->generationThread.join();
+
+            lock_guard<mutex> lock(this->lifecycleMutex);
+            this->generationThread = jthread();
+            this->paused = false;
+        }
+
+        void pauseGeneration() {
+
+            lock_guard<mutex> lock(this->lifecycleMutex);
+            if (!this->generationThread.joinable()) return;
+
+            this->paused = true;
+            this->lifecycleCondition.notify_all();
+        }
+
+        void resumeGeneration() {
+
+            lock_guard<mutex> lock(this->lifecycleMutex);
+            this->paused = false;
+            this->lifecycleCondition.notify_all();
+        }
+
+        bool isGenerating() {
+
+            lock_guard<mutex> lock(this->lifecycleMutex);
+            return this->generationThread.joinable() && !this->paused;
+        }
+
+        bool isPaused() {
+
+            lock_guard<mutex> lock(this->lifecycleMutex);
+            return this->generationThread.joinable() && this->paused;
+        }
+
+        // Also publish every generated data point to a shared memory ring for processor processes
+        void attachRing(ShmRing* ring) {
+
+            lock_guard<mutex> lock(bufferMutex);
+            this->ring = ring;
         }
 
         // Get dataType function
@@ -169,6 +458,12 @@ class Sensor {
             return dataType();
         }
 
+        // Total number of data points generated since the sensor was created
+        uint64_t getGeneratedCount() {
+
+            return this->generatedCount;
+        }
+
         bool isDataReady() {
 
             return this->dataReady;
@@ -179,99 +474,144 @@ class Sensor {
             this->dataReady = false;
         }
 
-        void setTiming(int timing) {
+        bool setTiming(int timing) {
 
             if (timing == PERIODICALLY || timing == ASYNCHRONOUS) {
 
                 this->timing = timing;
                 cout << "Sensor timing successfully set.";
-                return;
+                return true;
             }
 
             cout << "Invalid timing, 0 - Asynchronous, 1 - Periodically"; // Remove this line in the final version
+            return false;
         }
 
-        void setValueType(int type) {
+        bool setValueType(int type) {
 
-            if (type == RANDOM || type == DETERMINISTIC) {
+            if (type == RANDOM || type == DETERMINISTIC || type == SYNTHESIZED) {
 
                 this->valueType = type;
                 cout << "Sensor value type successfully set.\n";
-                return;
+                return true;
+            }
+
+            cout << "Invalid value type, 0 - Random, 1 - Deterministic, 2 - Synthesized"; // Remove this line in the final version
+            return false;
+        }
+
+        // Add a component to the synthesized signal, type is one of signalComponentNames
+        bool addSignalComponent(const string& type, const vector<double>& parameters) {
+
+            int componentType = static_cast<int>(find(signalComponentNames, signalComponentNames + SIGNAL_COMPONENT_TYPES, type) - signalComponentNames);
+
+            lock_guard<mutex> lock(bufferMutex);
+            if (this->synthesizer.addComponent(componentType, parameters)) {
+
+                cout << "Signal component successfully added.";
+                return true;
             }
 
-            cout << "Invalid value type, 0 - Random, 1 - Deterministic"; // Remove this line in the final version
+            cout << "Invalid signal component. Use sine, square, chirp, noise, drift, offset, spikes, dropouts or bursts with their parameters";
+            return false;
         }
 
-        void setLimit(int value) {
+        void clearSignalComponents() {
+
+            lock_guard<mutex> lock(bufferMutex);
+            this->synthesizer.clear();
+            cout << "Signal components cleared.";
+        }
+
+        // Sample rate the signal frequencies refer to
+        void setSignalSampleRate(double hz) {
+
+            lock_guard<mutex> lock(bufferMutex);
+            this->synthesizer.setSampleRate(hz);
+        }
+
+        string describeSignal() {
+
+            lock_guard<mutex> lock(bufferMutex);
+            return this->synthesizer.describe();
+        }
+
+        bool setLimit(int value) {
 
             if (value == RANGE || value == UNBOUNDED) {
 
                 this->limit = value;
                 cout << "Sensor value limit successfully set.\n";
-                return;
+                return true;
             }
 
             cout << "Invalid value limit, 0 - Range, 1 - Unbounded"; // Remove this line in the final version
+            return false;
         }
 
-        void setLowerBound(int value) {
+        bool setLowerBound(int value) {
 
             if (value < this->upperBound) {
 
                 this->lowerBound = value;
                 cout << "Lower bound successfully set.\n";
-                return;
+                return true;
             }
 
             cout << "Invalid lower bound value. Lower bound cannot be greater than upper bound.\n";
+            return false;
         }
 
-        void setUpperBound(int value) {
+        bool setUpperBound(int value) {
 
             if (value > this->lowerBound) {
 
                 this->upperBound = value;
                 cout << "Upper bound successfully set.\n";
-                return;
+                return true;
             }
 
             cout << "Invalid upper bound value. Upper bound cannot be less than lower bound.\n";
+            return false;
         }
 
-        void setPeriod(int value) {
+        bool setPeriod(int value) {
 
             if (value > 0) {
 
                 this->period = value;
                 cout << "Period successfully set.\n";
-                return;
+                return true;
             }
 
             cout << "Invalid period value. Period must be greater than 0.\n";
+            return false;
         }
 
-        void setMinPeriod(int value) {
+        bool setMinPeriod(int value) {
 
-            if (value > 0) {
+            // nextDelay draws from maxPeriod - minPeriod + 1 values, an empty range would divide by zero
+            if (value > 0 && value < this->maxPeriod) {
 
                 this->minPeriod = value;
                 cout << "Minimum period successfully set.\n";
-                return;
+                return true;
             }
 
-            cout << "Invalid minimum period value. Minimum period must be greater than 0.\n";
+            cout << "Invalid minimum period value. Minimum period must be greater than 0 and less than maximum period.\n";
+            return false;
         }
 
-        void setMaxPeriod(int value) {
+        bool setMaxPeriod(int value) {
 
             if (value > 0 && value > this->minPeriod) {
 
                 this->maxPeriod = value;
                 cout << "Maximum period successfully set.\n";
-                return;
+                return true;
             }
 
             cout << "Invalid maximum period value. Maximum period must be greater than 0 and greater than minimum period.\n";
+            return false;
         }
 };
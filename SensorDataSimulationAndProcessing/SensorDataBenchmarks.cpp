@@ -0,0 +1,303 @@
+// SensorDataBenchmarks.cpp: Microbenchmarks for the Sensor and DataProcessor hot paths across window and frame sizes.
+// Every case is run with a growing iteration count until it takes at least the minimum time, like Google Benchmark.
+// Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+// Usage: SensorDataBenchmarks [name filter] [--min-time seconds] [--csv]
+
+#include <sstream>
+#include <functional>
+
+#include "Sensor.cpp"
+#include "DataProcessor.cpp"
+#include "ColumnarExporter.cpp"
+#include "TestSupport.cpp"
+
+using namespace std;
+
+namespace {
+
+    // Keeps the compiler from removing a computation whose result is otherwise unused
+    template<typename T>
+    void doNotOptimize(const T& value) {
+
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T* sink;
+        sink = &value;
+#endif
+    }
+
+    class BenchmarkState {
+
+        private:
+
+            uint64_t remaining;
+
+        public:
+
+            int argument;
+            uint64_t itemsPerIteration = 1;
+
+            BenchmarkState(uint64_t iterations, int argument) : remaining(iterations), argument(argument) {}
+
+            bool keepRunning() {
+
+                return this->remaining-- > 0;
+            }
+    };
+
+    struct Benchmark {
+
+        string name;
+        function<void(BenchmarkState&)> run;
+        vector<int> arguments;
+    };
+
+    const vector<int> windowSizes = { 16, 64, 256, 512 };
+
+    // Fill the processor's window of the given size. The processor holds a mutex and cannot be returned by value.
+    void prepareProcessor(DataProcessor<double>& processor, int windowSize, int filterType) {
+
+        {
+            QuietOutput quiet;
+            processor.setRawDataSize(windowSize);
+            processor.setFilterType(filterType);
+        }
+
+        vector<double> data(windowSize);
+        for (int i = 0; i < windowSize; i++) data[i] = (i * 37) % 101;
+        processor.inputData(data);
+    }
+
+    vector<double> makeBatch(int size) {
+
+        vector<double> batch(size);
+        for (int i = 0; i < size; i++) batch[i] = (i * 53) % 97;
+        return batch;
+    }
+
+    // One batch of the default collect size, the common case of the processing thread
+    void inputDataSmallBatch(BenchmarkState& state) {
+
+        DataProcessor<double> processor;
+        prepareProcessor(processor, state.argument, 1);
+        vector<double> batch = makeBatch(5);
+        state.itemsPerIteration = batch.size();
+
+        while (state.keepRunning()) {
+
+            processor.inputData(batch);
+        }
+
+        doNotOptimize(processor.getRawData().back());
+    }
+
+    // A batch as large as the window replaces it completely
+    void inputDataFullWindow(BenchmarkState& state) {
+
+        DataProcessor<double> processor;
+        prepareProcessor(processor, state.argument, 0);
+        vector<double> batch = makeBatch(state.argument);
+        state.itemsPerIteration = batch.size();
+
+        while (state.keepRunning()) {
+
+            processor.inputData(batch);
+        }
+
+        doNotOptimize(processor.getRawData().back());
+    }
+
+    void movingAverageFilter(BenchmarkState& state) {
+
+        DataProcessor<double> processor;
+        prepareProcessor(processor, state.argument, 1);
+        {
+            QuietOutput quiet;
+            processor.setFilterSize(max(state.argument / 4, 1));
+        }
+
+        while (state.keepRunning()) {
+
+            DataProcessorProbe<double>::movingAverageFilter(processor);
+        }
+
+        doNotOptimize(processor.getFilteredData().back());
+    }
+
+    void collectData(BenchmarkState& state) {
+
+        Sensor<double> sensor;
+        sensor.setBufferSize(state.argument);
+        for (int i = 0; i < state.argument; i++) sensor.generateOnce();
+        state.itemsPerIteration = state.argument;
+
+        while (state.keepRunning()) {
+
+            vector<double> data = sensor.collectData(state.argument);
+            doNotOptimize(data.data());
+        }
+    }
+
+    void calculateSubsetAverages(BenchmarkState& state) {
+
+        DataProcessor<double> processor;
+        prepareProcessor(processor, state.argument, 1);
+        state.itemsPerIteration = state.argument;
+
+        while (state.keepRunning()) {
+
+            processor.calculateSubsetAverages(4);
+            doNotOptimize(processor.getSubsetAverages().size());
+        }
+    }
+
+    // Incremental spectrum with 75 % overlapping frames, one FFT every frameSize / 4 samples
+    void spectralAnalyzer(BenchmarkState& state) {
+
+        SpectralAnalyzer analyzer(state.argument, state.argument / 4);
+        vector<double> batch = makeBatch(64);
+        state.itemsPerIteration = batch.size();
+
+        while (state.keepRunning()) {
+
+            analyzer.addSamples(batch);
+        }
+
+        doNotOptimize(analyzer.getDominantFrequency());
+    }
+
+    // Encoding one column block of the columnar export, timestamps and sensor-like values
+    void columnarEncode(BenchmarkState& state) {
+
+        vector<int64_t> timestamps(state.argument);
+        vector<double> values(state.argument);
+        for (int i = 0; i < state.argument; i++) {
+
+            timestamps[i] = 1700000000000000000LL + (i / 5) * 100000000LL;
+            values[i] = static_cast<float>(50.0 + 40.0 * sin(i * 0.01) + (i * 37) % 11);
+        }
+
+        state.itemsPerIteration = state.argument;
+        vector<uint8_t> encoded;
+
+        while (state.keepRunning()) {
+
+            encoded.clear();
+            ColumnarCodec::encodeTimestamps(timestamps, encoded);
+            ColumnarCodec::encodeValues(values, encoded);
+            doNotOptimize(encoded.data());
+        }
+    }
+
+    // Synthesized signal in blocks of 4096 samples, the argument is the number of components
+    void signalSynthesizer(BenchmarkState& state) {
+
+        const vector<pair<int, vector<double>>> components = {
+            { SIGNAL_SINE, { 10.0, 50.0 } }, { SIGNAL_NOISE, { 1.0 } }, { SIGNAL_CHIRP, { 5.0, 1.0, 400.0, 2.0 } }, { SIGNAL_SPIKES, { 0.001, 100.0 } },
+            { SIGNAL_SQUARE, { 2.0, 5.0 } }, { SIGNAL_DRIFT, { 0.1 } }, { SIGNAL_OFFSET, { 50.0 } }, { SIGNAL_DROPOUTS, { 0.0001, 20.0 } }
+        };
+
+        SignalSynthesizer synthesizer;
+        synthesizer.setSampleRate(1000.0);
+        for (int i = 0; i < state.argument; i++) synthesizer.addComponent(components[i].first, components[i].second);
+
+        vector<double> samples(4096);
+        state.itemsPerIteration = samples.size();
+
+        while (state.keepRunning()) {
+
+            synthesizer.generate(samples.data(), samples.size());
+            doNotOptimize(samples.data());
+        }
+    }
+
+    struct Measurement {
+
+        uint64_t iterations;
+        uint64_t itemsPerIteration;
+        double seconds;
+    };
+
+    Measurement measure(const Benchmark& benchmark, int argument, double minTime) {
+
+        uint64_t iterations = 1;
+
+        while (true) {
+
+            BenchmarkState state(iterations, argument);
+            auto start = chrono::steady_clock::now();
+            benchmark.run(state);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            if (seconds >= minTime || iterations >= (1ULL << 40)) {
+
+                return { iterations, state.itemsPerIteration, seconds };
+            }
+
+            // Aim a little past the minimum time, growing at most tenfold per round
+            double scale = seconds > 0.0 ? 1.4 * minTime / seconds : 10.0;
+            iterations = max(iterations + 1, static_cast<uint64_t>(iterations * min(scale, 10.0)));
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    vector<Benchmark> benchmarks = {
+        { "inputData/batch5", inputDataSmallBatch, windowSizes },
+        { "inputData/fullWindow", inputDataFullWindow, windowSizes },
+        { "movingAverageFilter", movingAverageFilter, windowSizes },
+        { "collectData", collectData, { 5, 16, 64, 256 } },
+        { "calculateSubsetAverages", calculateSubsetAverages, windowSizes },
+        { "spectralAnalyzer", spectralAnalyzer, { 64, 256, 1024, 4096 } },
+        { "columnarEncode", columnarEncode, { 256, 4096 } },
+        { "signalSynthesizer", signalSynthesizer, { 1, 2, 4, 8 } },
+    };
+
+    string filter;
+    double minTime = 0.2;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++) {
+
+        string argument = argv[i];
+        if (argument == "--min-time" && i + 1 < argc) minTime = stod(argv[++i]);
+        else if (argument == "--csv") csv = true;
+        else filter = argument;
+    }
+
+    if (csv) {
+
+        cout << "name,iterations,ns_per_iteration,items_per_second\n";
+    }
+    else {
+
+        cout << left << setw(36) << "Benchmark" << right << setw(16) << "Time (ns)" << setw(14) << "Iterations" << setw(18) << "Items/s" << "\n";
+        cout << string(84, '-') << "\n";
+    }
+
+    for (const Benchmark& benchmark : benchmarks) {
+
+        for (int argument : benchmark.arguments) {
+
+            string name = benchmark.name + "/" + to_string(argument);
+            if (!filter.empty() && name.find(filter) == string::npos) continue;
+
+            Measurement result = measure(benchmark, argument, minTime);
+            double nsPerIteration = result.seconds * 1e9 / result.iterations;
+            double itemsPerSecond = result.iterations * result.itemsPerIteration / result.seconds;
+
+            if (csv) {
+
+                cout << name << "," << result.iterations << "," << fixed << setprecision(2) << nsPerIteration << "," << setprecision(0) << itemsPerSecond << "\n";
+            }
+            else {
+
+                cout << left << setw(36) << name << right << fixed << setprecision(1) << setw(16) << nsPerIteration << setw(14) << result.iterations << setprecision(0) << setw(18) << itemsPerSecond << "\n";
+            }
+        }
+    }
+
+    return 0;
+}
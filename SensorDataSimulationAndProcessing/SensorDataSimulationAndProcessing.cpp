@@ -4,39 +4,226 @@
 using namespace std;
 
 
-int main()
+// The test target includes this file to reach the option and setting parsing, it defines SENSOR_SIMULATION_NO_MAIN
+#ifndef SENSOR_SIMULATION_NO_MAIN
+int main(int argc, char* argv[])
 {
 	using sensorDataType = float; // You can change the sensor data type. This type can be int, double and float.
 
 	Sensor<sensorDataType> sensor;
 	DataProcessor<sensorDataType> processor;
+
+    RunOptions options;
+    if (!parseArguments(argc, argv, options)) {
+
+        return 2;
+    }
+
+    if (!options.shmSensorName.empty() && shmRing.create(options.shmSensorName, shmRingCapacity, sizeof(sensorDataType))) {
+
+        shmRole = SHM_ROLE_SENSOR;
+        sensor.attachRing(&shmRing);
+    }
+    else if (!options.shmProcessorName.empty() && shmRing.open(options.shmProcessorName, sizeof(sensorDataType))) {
+
+        shmRole = SHM_ROLE_PROCESSOR;
+    }
+
+    processor.setSpectrumSampleRate(sensorSampleRate(sensor));
+    sensor.setSignalSampleRate(sensorSampleRate(sensor));
+
+    if (options.headless) {
+
+        return runHeadless(sensor, processor, options);
+    }
+
+    for (const string& setting : options.settings) {
+
+        istringstream iss(setting);
+        string property;
+        iss >> property;
+        applySetting(property, iss, sensor, processor);
+    }
+
     displaySensorStatics(sensor);
     displayProcessingStatics(processor);
 
     thread command(commandThread<sensorDataType>, ref(sensor), ref(processor));
-    thread processing(processingThread<sensorDataType>, ref(sensor), ref(processor));
+    thread processing;
+    if (shmRole != SHM_ROLE_SENSOR) {
+
+        processing = thread(processingThread<sensorDataType>, ref(sensor), ref(processor));
+    }
 
     command.join();
-    processing.join();
+    if (processing.joinable()) processing.join();
+    dataPublisher.stop();
+    columnarExporter.stop();
+    shmRing.close();
 
 	return 0;
 }
+#endif
+
+// Parse the value of a numeric option, the whole text must be a non-negative integer no larger than maxValue
+bool parseOptionNumber(const string& option, const string& text, uint64_t maxValue, uint64_t& value) {
+
+    size_t used = 0;
+
+    try {
+
+        if (!text.empty() && isdigit(static_cast<unsigned char>(text[0]))) value = stoull(text, &used);
+    }
+    catch (const exception&) {
+
+        used = 0;
+    }
+
+    if (used == 0 || used != text.size()) {
+
+        cerr << "Invalid value for " << option << ": " << text << ", a non-negative integer is expected\n";
+        return false;
+    }
+
+    if (value > maxValue) {
+
+        cerr << "Invalid value for " << option << ": " << text << ", at most " << maxValue << " is allowed\n";
+        return false;
+    }
+
+    return true;
+}
+
+// Command line options:
+//   --headless             Run without the console interface and print a JSON summary at the end
+//   --config FILE          Apply "property value" lines, the same properties as the set command
+//   --set property=value   Apply a single setting
+//   --duration MS          Run time of a headless run (simulated time with --virtual-time)
+//   --samples N            Stop a headless run after N processed samples
+//   --virtual-time         Run a headless run on the virtual simulation clock
+//   --summary FILE         Write the summary to FILE instead of stdout
+//   --publish              Stream processed data over the local socket
+//   --export FILE          Write processed data to a columnar file, read it with ColumnarReader
+//   --pipelines N          Run N independent pipelines on the coroutine executor in a headless run
+//   --threads N            Worker threads of the coroutine executor
+//   --shm-sensor NAME      Run only the sensor and publish to a shared memory ring
+//   --shm-processor NAME   Run only the processor and consume from a shared memory ring
+bool parseArguments(int argc, char* argv[], RunOptions& options) {
+
+    for (int i = 1; i < argc; i++) {
+
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--headless") {
+
+            options.headless = true;
+        }
+        else if (argument == "--virtual-time") {
+
+            options.virtualTime = true;
+        }
+        else if (argument == "--publish") {
+
+            options.publish = true;
+        }
+        else if (argument == "--config" && hasValue) {
+
+            ifstream file(argv[++i]);
+            if (!file) {
+
+                cerr << "Could not open configuration file " << argv[i] << "\n";
+                return false;
+            }
+
+            string line;
+            while (getline(file, line)) {
+
+                line = line.substr(0, line.find('#'));
+                if (line.find_first_not_of(" \t\r") != string::npos) {
+
+                    options.settings.push_back(line);
+                }
+            }
+        }
+        else if (argument == "--set" && hasValue) {
+
+            string setting = argv[++i];
+            replace(setting.begin(), setting.end(), '=', ' ');
+            options.settings.push_back(setting);
+        }
+        else if (argument == "--duration" && hasValue) {
+
+            if (!parseOptionNumber(argument, argv[++i], UINT64_MAX, options.durationMs)) return false;
+        }
+        else if (argument == "--samples" && hasValue) {
+
+            if (!parseOptionNumber(argument, argv[++i], UINT64_MAX, options.maxSamples)) return false;
+        }
+        else if (argument == "--pipelines" && hasValue) {
+
+            uint64_t pipelines = 0;
+            if (!parseOptionNumber(argument, argv[++i], 1024, pipelines)) return false;
+            options.pipelines = static_cast<int>(pipelines);
+        }
+        else if (argument == "--threads" && hasValue) {
+
+            uint64_t threads = 0;
+            if (!parseOptionNumber(argument, argv[++i], 64, threads)) return false;
+            executorThreads = max(static_cast<int>(threads), 1);
+        }
+        else if (argument == "--export" && hasValue) {
+
+            options.exportPath = argv[++i];
+        }
+        else if (argument == "--summary" && hasValue) {
+
+            options.summaryPath = argv[++i];
+        }
+        else if (argument == "--shm-sensor" && hasValue) {
+
+            options.shmSensorName = argv[++i];
+        }
+        else if (argument == "--shm-processor" && hasValue) {
+
+            options.shmProcessorName = argv[++i];
+        }
+        else {
+
+            cerr << "Unknown or incomplete option: " << argument << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
 
 template <typename dataType>
 void displaySensorStatics(Sensor<dataType>& sensor) {
 
+    if (!consoleOutput) {
+
+        return;
+    }
+
+    // The composition of a synthesized signal is shortened to fit the column
+    string signal = sensor.describeSignal();
+    if (signal.size() > 20) signal = signal.substr(0, 17) + "...";
+
     std::ostringstream stats;
 
-    stats << "SENSOR CONFIGURATION:\n";
+    stats << "SENSOR CONFIGURATION: " << (sensor.isGenerating() ? "(running)" : (sensor.isPaused() ? "(paused)" : "(stopped)")) << "\n";
     stats << "|- Timing: " << (sensor.timing == 0 ? "Asynchronous" : "Periodically") << endl;
     stats << "|- Period: " << sensor.period << endl;
     stats << "|__ Min Period: " << sensor.minPeriod << endl;
     stats << "|__ Max Period: " << sensor.maxPeriod << endl;
-    stats << "|- Value Type: " << (sensor.valueType == 0 ? "Random" : "Deterministic") << endl;
+    stats << "|- Value Type: " << (sensor.valueType == RANDOM ? "Random" : (sensor.valueType == DETERMINISTIC ? "Deterministic" : "Synthesized: " + signal)) << endl;
     stats << "|- Limit: " << (sensor.limit == 0 ? "Range" : "Unbounded") << endl;
     stats << "|__ Upper Bound: " << sensor.upperBound << endl;
     stats << "|__ Lower Bound: " << sensor.lowerBound << endl;
     stats << "|- Data Buffer Size: " << sensor.dataBufferSize << endl;
+    stats << "|- Seed: " << sensor.seed << endl;
+    stats << "|- CPU: " << sensor.placement.describe() << endl;
 
     printInRegion(sensorStaticsStartCol, sensorStaticsStartRow, sensorStaticsEndRow, stats.str()); // Region 1: Rows 1-10
 }
@@ -44,6 +231,11 @@ void displaySensorStatics(Sensor<dataType>& sensor) {
 template <typename dataType>
 void displayProcessingStatics(DataProcessor<dataType>& processor) {
 
+    if (!consoleOutput) {
+
+        return;
+    }
+
     std::ostringstream stats;
 
     stats << "         ################ -- SENSOR AND DATA PROCESSOR CONFIGURATION -- ################\n";
@@ -55,9 +247,14 @@ void displayProcessingStatics(DataProcessor<dataType>& processor) {
     stats << "|- Filter Type: " << (processor.filterType == 0 ? "No Filter" : "Moving Avarage Filter") << endl;
     stats << "|- Filter Size: " << processor.filterSize << endl;
     stats << "|- Number of Data Points: " << processor.rawDataSize << endl;
-    stats << "|- Polling Rate: " << processorPollingRate << " ms" << endl;
+    stats << "|- Polling Rate: " << processorPollingRate << " ms" << (adaptivePolling ? " (adaptive)" : "") << endl;
     stats << "|- Collect Size: " << processorCollectSize << " data per polling" << endl;
+    stats << "|- Sketch: " << processor.sketchAccuracy << " % accuracy, " << processor.sketchMaxBuckets << " buckets" << endl;
     stats << "|- Print Data: " << (printDataStatistics ? "True" : "False") << endl;
+    stats << "|- Transport: " << (shmRole == SHM_ROLE_NONE ? "In-process" : (shmRole == SHM_ROLE_SENSOR ? "Shared memory producer " : "Shared memory consumer ") + shmRing.getName()) << endl;
+    stats << "|- Executor: " << (useExecutor ? "Coroutines (" + to_string(executorThreads) + " threads)" : "Threads") << endl;
+    stats << "|- Publish: " << (dataPublisher.isActive() ? "On" : "Off") << ", Export: " << (columnarExporter.isActive() ? "On (" + to_string(columnarExporter.getBlocksWritten()) + " blocks)" : "Off") << endl;
+    stats << "|- CPU: " << processorPlacement.describe() << endl;
 
     printInRegion(processorStaticsStartCol, processorStaticsStartRow, processorStaticsEndRow, stats.str()); // Region 1: Rows 1-10
 }
@@ -65,6 +262,11 @@ void displayProcessingStatics(DataProcessor<dataType>& processor) {
 template <typename dataType>
 void displayStatistics(DataProcessor<dataType>& processor) {
 
+    if (!consoleOutput) {
+
+        return;
+    }
+
     std::ostringstream stats;
 
     stats << "         ################ -------- PROCESSED SIGNAL STATISTICS -------- ################\n";
@@ -92,6 +294,80 @@ void displayStatistics(DataProcessor<dataType>& processor) {
 
     printInRegion(filteredStatisticsStartCol, filteredStatisticsStartRow, filteredStatisticsEndRow, stats.str());
 
+    stats.str("");
+    stats << "RAW DATA PERCENTILES:\n";
+    stats << "|- P50: " << processor.getRawPercentile(0.50) << "\n";
+    stats << "|- P95: " << processor.getRawPercentile(0.95) << "\n";
+    stats << "|- P99: " << processor.getRawPercentile(0.99) << "\n";
+
+    printInRegion(rawPercentilesStartCol, rawPercentilesStartRow, rawPercentilesEndRow, stats.str());
+
+    stats.str("");
+    stats << "FILTERED DATA PERCENTILES:\n";
+    stats << "|- P50: " << processor.getFilteredPercentile(0.50) << "\n";
+    stats << "|- P95: " << processor.getFilteredPercentile(0.95) << "\n";
+    stats << "|- P99: " << processor.getFilteredPercentile(0.99) << "\n";
+
+    printInRegion(filteredPercentilesStartCol, filteredPercentilesStartRow, filteredPercentilesEndRow, stats.str());
+
+    if (adaptivePolling) {
+
+        stats.str("");
+        stats << "ADAPTIVE CONTROLLER:" << (pollingController.budgetLimited ? " (limited by wakeup budget)" : "") << "\n";
+        stats << "|- Estimated Rate: " << pollingController.estimatedRate << " samples/s\n";
+        stats << "|- Polling Rate: " << pollingController.pollingRate << " ms (" << pollingController.getWakeupsPerSecond() << " wakeups/s)\n";
+        stats << "|- Collect Size: " << pollingController.collectSize << " data per polling\n";
+        stats << "|- Expected Latency: " << pollingController.getExpectedLatency() << " ms (target " << pollingController.targetLatency << " ms)\n";
+        stats << "|- Overflowed Samples: " << pollingController.overflowSamples << "\n";
+
+        printInRegion(controllerStartCol, controllerStartRow, controllerEndRow, stats.str());
+    }
+
+    // The rule count is read under the processor's lock, set rule changes the rules from the command thread
+    AnomalyDetector& detector = processor.getAnomalyDetector();
+    size_t ruleCount = processor.getAnomalyRuleCount();
+    if (ruleCount > 0) {
+
+        stats.str("");
+        stats << "ANOMALY DETECTION:\n";
+        stats << "|- Rules: " << ruleCount << ", Events: " << detector.getTotalEvents() << "\n";
+
+        // Newest events first
+        const deque<AnomalyEvent>& events = detector.getRecentEvents();
+        for (auto it = events.rbegin(); it != events.rend() && it - events.rbegin() < 5; ++it) {
+
+            stats << "|- #" << it->sampleIndex << " " << anomalyRuleNames[it->ruleType] << " " << it->threshold << ": " << it->value
+                << " @" << (it->timestampNs / 1000000) % 100000 << " ms\n";
+        }
+
+        printInRegion(anomalyStartCol, anomalyStartRow, anomalyEndRow, stats.str());
+    }
+
+    SpectralAnalyzer& spectrum = processor.getSpectralAnalyzer();
+    if (spectrum.isEnabled()) {
+
+        stats.str("");
+        stats << "SPECTRUM:\n";
+        stats << "|- Frames: " << spectrum.getFrameCount() << " (" << spectrum.getFrameSize() << " samples, hop " << spectrum.getHopSize() << ")\n";
+        stats << "|- Dominant Frequency: " << spectrum.getDominantFrequency() << " Hz\n";
+        stats << "|- Spectral Flatness: " << spectrum.getSpectralFlatness() << "\n";
+        stats << "|- Sample Rate: " << spectrum.getSampleRate() << " Hz\n";
+
+        printInRegion(spectrumStartCol, spectrumStartRow, spectrumEndRow, stats.str());
+
+        stats.str("");
+        stats << "BAND ENERGY:\n";
+        for (int band = 0; band < SPECTRAL_BANDS; band++) {
+
+            double share = spectrum.getBandEnergy(band);
+            double bandWidth = spectrum.getSampleRate() / 2.0 / SPECTRAL_BANDS;
+            stats << "|- " << band * bandWidth << "-" << (band + 1) * bandWidth << " Hz: " << static_cast<int>(share * 100.0 + 0.5) << " % "
+                << string(static_cast<size_t>(share * 20.0 + 0.5), '#') << "\n";
+        }
+
+        printInRegion(bandEnergyStartCol, bandEnergyStartRow, bandEnergyEndRow, stats.str());
+    }
+
     if (!printDataStatistics) {
 
         return;
@@ -111,130 +387,941 @@ void displayStatistics(DataProcessor<dataType>& processor) {
         stats << *it << " ";
     }
 
-    printInRegion(1, rawStatisticsEndRow - 4, rawStatisticsEndRow, stats.str());
+    printInRegion(1, printDataStartRow, printDataEndRow, stats.str());
 
 }
 
-template <typename dataType>
-void processCommand(string& command, Sensor<dataType>& sensor, DataProcessor<dataType>& processor) {
+// Average sample rate of the sensor, used to label the spectrum. Asynchronous sensors are only uniformly
+// sampled on average, so their spectrum is an approximation.
+template<typename dataType>
+double sensorSampleRate(Sensor<dataType>& sensor) {
 
-    clearLine(infoRow);
-    istringstream iss(command);
-    string action, property;
-    iss >> action;
+    if (sensor.timing == PERIODICALLY) {
 
-    if (action == "set") {
+        return 1000.0 / sensor.period;
+    }
 
-        int value;
-        iss >> property;
-        if (property == "timing") {
-            iss >> value;
-            sensor.setTiming(value);
+    return 2000.0 / (sensor.minPeriod + sensor.maxPeriod);
+}
+
+// Hand the new samples of the processed batch to the enabled sinks, the socket publisher and the columnar export.
+// timestamps are the generation times of the samples, without them the export stamps every sample with the batch time.
+template<typename dataType>
+void publishProcessedData(DataProcessor<dataType>& processor, const vector<dataType>& data, const vector<int64_t>& timestamps) {
+
+    bool publishing = dataPublisher.isActive();
+    bool exporting = columnarExporter.isActive();
+
+    if (!publishing && !exporting) {
+
+        return;
+    }
+
+    vector<dataType> dataRaw = processor.getRawData();
+    vector<double> dataFiltered = processor.getFilteredData();
+
+    vector<double> statistics = {
+        processor.getMinValue(dataRaw), processor.getMaxValue(dataRaw), processor.calculateAverage(dataRaw),
+        processor.getRawPercentile(0.50), processor.getRawPercentile(0.95), processor.getRawPercentile(0.99),
+        processor.getMinValue(dataFiltered), processor.getMaxValue(dataFiltered), processor.calculateAverage(dataFiltered),
+        processor.getFilteredPercentile(0.50), processor.getFilteredPercentile(0.95), processor.getFilteredPercentile(0.99)
+    };
+
+    vector<double> latestFiltered = processor.getLatestFilteredData();
+    const vector<AnomalyEvent>& events = processor.getAnomalyDetector().getLatestEvents();
+
+    if (publishing) {
+
+        dataPublisher.publish(FRAME_RAW, data);
+        dataPublisher.publish(FRAME_FILTERED, latestFiltered);
+        dataPublisher.publish(FRAME_STATISTICS, statistics);
+
+        if (!events.empty()) {
+
+            vector<double> anomalies;
+            anomalies.reserve(events.size() * ANOMALY_FIELD_COUNT);
+            for (const AnomalyEvent& event : events) {
+
+                anomalies.insert(anomalies.end(), { static_cast<double>(event.sampleIndex), static_cast<double>(event.ruleType), event.threshold, event.value });
+            }
+            dataPublisher.publish(FRAME_ANOMALY, anomalies);
         }
-        else if (property == "valuetype") {
-            iss >> value;
-            sensor.setValueType(value);
+    }
+
+    if (exporting) {
+
+        columnarExporter.append(currentTimestampNs(), timestamps, data, latestFiltered, statistics);
+        columnarExporter.appendAnomalies(events);
+    }
+}
+
+void adaptPolling(uint64_t generatedCount, uint64_t nowMs) {
+
+    if (!adaptivePolling) {
+
+        return;
+    }
+
+    pollingController.update(generatedCount, nowMs, processorMaxPollingRate, processorMaxCollectSize);
+    processorPollingRate = pollingController.pollingRate;
+    processorCollectSize = pollingController.collectSize;
+}
+
+template<typename dataType>
+bool collectAndProcess(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, vector<dataType>& data) {
+
+    if (!sensor.isDataReady()) {
+
+        return false;
+    }
+
+    data = sensor.collectData(processorCollectSize);
+    sensor.clearDataReady();
+
+    if (data.empty()) {
+
+        return false;
+    }
+
+    // Only the samples no earlier batch contained go to the sinks
+    size_t newCount = sensor.getNewDataCount();
+    processor.inputData(data, newCount);
+    vector<int64_t> timestamps = sensor.getCollectedTimestamps();
+    publishProcessedData(processor, vector<dataType>(data.end() - newCount, data.end()), vector<int64_t>(timestamps.end() - min(newCount, timestamps.size()), timestamps.end()));
+    processedSamples += newCount;
+    processedBatches++;
+    return true;
+}
+
+template<typename T>
+uint64_t hashValues(uint64_t hash, const vector<T>& values) {
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values.data());
+    for (size_t i = 0; i < values.size() * sizeof(T); i++) {
+
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Run the sensor and the processor on a virtual clock: generation and polling are scheduled as events
+// and time jumps between them, so the run is as fast as the processing and identical for the same seed.
+template<typename dataType>
+SimulationSummary runVirtualSimulation(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, uint64_t durationMs, uint64_t maxSamples) {
+
+    SimulationClock clock;
+    SimulationTimestamps timestamps(clock);
+    SimulationSummary summary;
+    summary.checksum = 14695981039346656037ULL;
+    vector<dataType> data;
+
+    function<void()> generate = [&]() {
+
+        uint64_t before = sensor.getGeneratedCount();
+        int delay = sensor.generateArrivals();
+        summary.generatedSamples += sensor.getGeneratedCount() - before;
+        clock.schedule(delay, generate);
+    };
+
+    function<void()> poll = [&]() {
+
+        adaptPolling(sensor.getGeneratedCount(), clock.now());
+
+        if (collectAndProcess(sensor, processor, data)) {
+
+            summary.processedSamples += sensor.getNewDataCount();
+            summary.processedBatches++;
+            summary.checksum = hashValues(summary.checksum, data);
+            summary.checksum = hashValues(summary.checksum, processor.getLatestFilteredData());
+
+            if (maxSamples > 0 && summary.processedSamples >= maxSamples) {
+
+                clock.stop();
+            }
         }
-        else if (property == "limit") {
-            iss >> value;
-            sensor.setLimit(value);
+
+        clock.schedule(processorPollingRate, poll);
+    };
+
+    auto wallStart = chrono::steady_clock::now();
+
+    clock.schedule(0, generate);
+    clock.schedule(0, poll);
+    clock.runUntil(durationMs);
+
+    summary.simulatedMs = clock.now();
+    summary.wallMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - wallStart).count();
+    return summary;
+}
+
+// Run the real-time threads until the duration has passed or maxSamples samples were processed
+template<typename dataType>
+SimulationSummary runRealTime(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, uint64_t durationMs, uint64_t maxSamples) {
+
+    SimulationSummary summary;
+    auto startTime = chrono::steady_clock::now();
+    uint64_t elapsedMs = 0;
+
+    isGenerate = true;
+    if (shmRole != SHM_ROLE_PROCESSOR) {
+
+        sensor.startGeneration();
+    }
+
+    thread processing;
+    if (shmRole != SHM_ROLE_SENSOR) {
+
+        processing = thread(processingThread<dataType>, ref(sensor), ref(processor));
+    }
+
+    while (elapsedMs < durationMs && (maxSamples == 0 || processedSamples < maxSamples)) {
+
+        this_thread::sleep_for(chrono::milliseconds(min<uint64_t>(10, durationMs - elapsedMs)));
+        elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    isGenerate = false;
+    isRunning = false;
+    sensor.stopGeneration();
+    if (processing.joinable()) processing.join();
+
+    summary.simulatedMs = elapsedMs;
+    summary.wallMs = elapsedMs;
+    summary.generatedSamples = shmRole == SHM_ROLE_PROCESSOR ? shmRing.getWrittenCount() : sensor.getGeneratedCount();
+    summary.processedSamples = processedSamples;
+    summary.processedBatches = processedBatches;
+    return summary;
+}
+
+// JSON has no nan or infinity, such values are written as null
+string jsonNumber(double value) {
+
+    if (!isfinite(value)) return "null";
+
+    ostringstream text;
+    text << value;
+    return text.str();
+}
+
+template<typename dataType, typename T>
+void writeJsonStatistics(ostream& out, DataProcessor<dataType>& processor, const char* name, vector<T>& data, double p50, double p95, double p99) {
+
+    out << "  \"" << name << "\": { \"min\": " << jsonNumber(processor.getMinValue(data)) << ", \"max\": " << jsonNumber(processor.getMaxValue(data))
+        << ", \"average\": " << jsonNumber(processor.calculateAverage(data)) << ", \"p50\": " << jsonNumber(p50) << ", \"p95\": " << jsonNumber(p95)
+        << ", \"p99\": " << jsonNumber(p99) << " },\n";
+}
+
+// The interactive pipeline when start runs on the coroutine executor
+template<typename dataType>
+unique_ptr<SensorPipeline<dataType>>& interactivePipeline() {
+
+    static unique_ptr<SensorPipeline<dataType>> pipeline;
+    return pipeline;
+}
+
+template<typename dataType>
+void startPipeline(Sensor<dataType>& sensor, DataProcessor<dataType>& processor) {
+
+    unique_ptr<SensorPipeline<dataType>>& pipeline = interactivePipeline<dataType>();
+    if (pipeline) {
+
+        return;
+    }
+
+    pipelineExecutor.start(executorThreads, &processorPlacement);
+    pipeline = make_unique<SensorPipeline<dataType>>(pipelineExecutor, sensor, processor);
+    pipeline->collectSize = processorCollectSize;
+
+    SensorPipeline<dataType>* running = pipeline.get();
+    pipeline->onProcessed = [&processor](const vector<dataType>& data, const vector<int64_t>& timestamps) {
+
+        publishProcessedData(processor, data, timestamps);
+        processedSamples += data.size();
+        processedBatches++;
+    };
+    pipeline->onOutput = [running, &processor](const PipelineStatistics&) {
+
+        lock_guard<mutex> lock(running->processorMutex);
+        displayStatistics(processor);
+    };
+
+    pipeline->start();
+}
+
+// Cancel the interactive pipeline, wait for its stages to drain and stop the executor
+template<typename dataType>
+void stopPipeline() {
+
+    unique_ptr<SensorPipeline<dataType>>& pipeline = interactivePipeline<dataType>();
+    if (!pipeline) {
+
+        return;
+    }
+
+    pipeline->cancel();
+    pipeline->waitFinished();
+    pipeline.reset();
+    pipelineExecutor.stop();
+}
+
+// Run options.pipelines independent pipelines on the executor. The first one uses the given sensor and
+// processor, the others get their own with the same settings and consecutive seeds.
+template<typename dataType>
+SimulationSummary runPipelines(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, RunOptions& options) {
+
+    SimulationSummary summary;
+    vector<unique_ptr<Sensor<dataType>>> sensors;
+    vector<unique_ptr<DataProcessor<dataType>>> processors;
+    vector<unique_ptr<SensorPipeline<dataType>>> pipelines;
+
+    // Setter messages of the extra pipelines are discarded
+    streambuf* stdoutBuffer = cout.rdbuf(nullptr);
+    for (int i = 1; i < options.pipelines; i++) {
+
+        sensors.push_back(make_unique<Sensor<dataType>>());
+        processors.push_back(make_unique<DataProcessor<dataType>>());
+
+        for (const string& setting : options.settings) {
+
+            istringstream iss(setting);
+            string property;
+            iss >> property;
+            applySetting(property, iss, *sensors.back(), *processors.back());
         }
-        else if (property == "upperbound") {
-            iss >> value;
-            sensor.setUpperBound(value);
+
+        sensors.back()->setSeed(sensor.seed + i);
+    }
+    cout.rdbuf(stdoutBuffer);
+
+    pipelineExecutor.start(executorThreads, &processorPlacement);
+    auto startTime = chrono::steady_clock::now();
+
+    for (int i = 0; i < options.pipelines; i++) {
+
+        Sensor<dataType>& pipelineSensor = i == 0 ? sensor : *sensors[i - 1];
+        DataProcessor<dataType>& pipelineProcessor = i == 0 ? processor : *processors[i - 1];
+
+        pipelines.push_back(make_unique<SensorPipeline<dataType>>(pipelineExecutor, pipelineSensor, pipelineProcessor));
+        pipelines.back()->collectSize = processorCollectSize;
+        if (i == 0) {
+
+            pipelines.back()->onProcessed = [&processor](const vector<dataType>& data, const vector<int64_t>& timestamps) { publishProcessedData(processor, data, timestamps); };
+        }
+        pipelines.back()->start();
+    }
+
+    uint64_t elapsedMs = 0;
+    while (elapsedMs < options.durationMs) {
+
+        this_thread::sleep_for(chrono::milliseconds(min<uint64_t>(10, options.durationMs - elapsedMs)));
+        elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+
+        uint64_t processed = 0;
+        for (auto& pipeline : pipelines) {
+
+            processed += pipeline->processedSamples;
+        }
+
+        if (options.maxSamples > 0 && processed >= options.maxSamples) break;
+    }
+
+    for (auto& pipeline : pipelines) {
+
+        pipeline->cancel();
+    }
+
+    for (auto& pipeline : pipelines) {
+
+        pipeline->waitFinished();
+        summary.processedSamples += pipeline->processedSamples;
+        summary.processedBatches += pipeline->processedBatches;
+    }
+
+    pipelineExecutor.stop();
+
+    summary.generatedSamples = sensor.getGeneratedCount();
+    for (auto& pipelineSensor : sensors) {
+
+        summary.generatedSamples += pipelineSensor->getGeneratedCount();
+    }
+
+    summary.simulatedMs = elapsedMs;
+    summary.wallMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+    return summary;
+}
+
+// Headless run: apply the settings, run without console rendering and write a JSON summary
+template<typename dataType>
+int runHeadless(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, RunOptions& options) {
+
+    consoleOutput = false;
+
+    // Setter messages go to stderr so that stdout only carries the summary
+    streambuf* stdoutBuffer = cout.rdbuf(cerr.rdbuf());
+    bool settingsValid = true;
+
+    for (const string& setting : options.settings) {
+
+        istringstream iss(setting);
+        string property;
+        iss >> property;
+        settingsValid = applySetting(property, iss, sensor, processor) && settingsValid;
+        cout << "\n";
+    }
+
+    if (options.publish) {
+
+        dataPublisher.start(publishSocketPath);
+    }
+
+    if (!options.exportPath.empty()) {
+
+        exportPath = options.exportPath;
+        settingsValid = columnarExporter.start(exportPath) && settingsValid;
+    }
+
+    cout.rdbuf(stdoutBuffer);
+
+    if (!settingsValid) {
+
+        return 2;
+    }
+
+    if (options.pipelines > 0 && (options.virtualTime || shmRole != SHM_ROLE_NONE)) {
+
+        cerr << "--pipelines cannot be combined with --virtual-time or shared memory roles\n";
+        return 2;
+    }
+
+    SimulationSummary summary;
+    if (options.pipelines > 0) {
+
+        summary = runPipelines(sensor, processor, options);
+    }
+    else if (options.virtualTime) {
+
+        summary = runVirtualSimulation(sensor, processor, options.durationMs, options.maxSamples);
+    }
+    else {
+
+        summary = runRealTime(sensor, processor, options.durationMs, options.maxSamples);
+    }
+
+    dataPublisher.stop();
+    columnarExporter.stop();
+
+    ofstream summaryFile;
+    if (!options.summaryPath.empty()) {
+
+        summaryFile.open(options.summaryPath);
+        if (!summaryFile) {
+
+            cerr << "Could not open summary file " << options.summaryPath << "\n";
+            return 1;
         }
-        else if (property == "lowerbound") {
-            iss >> value;
-            sensor.setLowerBound(value);
+    }
+
+    ostream& out = options.summaryPath.empty() ? cout : summaryFile;
+    vector<dataType> dataRaw = processor.getRawData();
+    vector<double> dataFiltered = processor.getFilteredData();
+    double throughput = summary.wallMs > 0 ? summary.processedSamples * 1000.0 / summary.wallMs : 0.0;
+
+    out << "{\n";
+    out << "  \"mode\": \"" << (options.pipelines > 0 ? "pipelines" : (options.virtualTime ? "virtual" : "realtime")) << "\",\n";
+    out << "  \"pipelines\": " << max(options.pipelines, 1) << ",\n";
+    out << "  \"simulatedMs\": " << summary.simulatedMs << ",\n";
+    out << "  \"wallMs\": " << summary.wallMs << ",\n";
+    out << "  \"generatedSamples\": " << summary.generatedSamples << ",\n";
+    out << "  \"processedSamples\": " << summary.processedSamples << ",\n";
+    out << "  \"processedBatches\": " << summary.processedBatches << ",\n";
+    out << "  \"samplesPerSecond\": " << jsonNumber(throughput) << ",\n";
+    out << "  \"pollingRate\": " << processorPollingRate << ",\n";
+    out << "  \"collectSize\": " << processorCollectSize << ",\n";
+    out << "  \"publishedFrames\": " << dataPublisher.getFramesPublished() << ",\n";
+    out << "  \"droppedFrames\": " << dataPublisher.getFramesDropped() << ",\n";
+    out << "  \"exportedRows\": " << columnarExporter.getRowsExported() << ",\n";
+    out << "  \"exportDroppedRows\": " << columnarExporter.getRowsDropped() << ",\n";
+    out << "  \"exportedBytes\": " << columnarExporter.getBytesWritten() << ",\n";
+    out << "  \"anomalyEvents\": " << processor.getAnomalyDetector().getTotalEvents() << ",\n";
+    writeJsonStatistics(out, processor, "raw", dataRaw, processor.getRawPercentile(0.50), processor.getRawPercentile(0.95), processor.getRawPercentile(0.99));
+    writeJsonStatistics(out, processor, "filtered", dataFiltered, processor.getFilteredPercentile(0.50), processor.getFilteredPercentile(0.95), processor.getFilteredPercentile(0.99));
+    SpectralAnalyzer& spectrum = processor.getSpectralAnalyzer();
+    out << "  \"spectrum\": { \"frames\": " << spectrum.getFrameCount() << ", \"dominantHz\": " << jsonNumber(spectrum.getDominantFrequency())
+        << ", \"flatness\": " << jsonNumber(spectrum.getSpectralFlatness()) << ", \"bands\": [";
+    for (int band = 0; band < SPECTRAL_BANDS; band++) {
+
+        out << (band > 0 ? ", " : "") << jsonNumber(spectrum.getBandEnergy(band));
+    }
+    out << "] }";
+
+    // Only a virtual run is reproducible, so only it has a checksum
+    if (options.virtualTime) {
+
+        out << ",\n  \"checksum\": \"" << hex << summary.checksum << dec << "\"";
+    }
+    out << "\n}\n";
+
+    return 0;
+}
+
+// Apply one "property value" setting, shared by the set command and the headless configuration.
+// Returns false for an unknown property, a missing or non-numeric value and a value the setter rejects.
+template <typename dataType>
+bool applySetting(const string& property, istream& iss, Sensor<dataType>& sensor, DataProcessor<dataType>& processor) {
+
+    int value = 0;
+    bool valid = true;
+
+    auto readValue = [&]() {
+
+        if (iss >> value) return true;
+
+        cout << "Invalid value for " << property << ", a number is expected.\n";
+        return false;
+    };
+
+    if (property == "timing") {
+        valid = readValue() && sensor.setTiming(value);
+    }
+    else if (property == "valuetype") {
+        valid = readValue() && sensor.setValueType(value);
+    }
+    else if (property == "limit") {
+        valid = readValue() && sensor.setLimit(value);
+    }
+    else if (property == "upperbound") {
+        valid = readValue() && sensor.setUpperBound(value);
+    }
+    else if (property == "lowerbound") {
+        valid = readValue() && sensor.setLowerBound(value);
+    }
+    else if (property == "period") {
+        valid = readValue() && sensor.setPeriod(value);
+    }
+    else if (property == "minperiod") {
+        valid = readValue() && sensor.setMinPeriod(value);
+    }
+    else if (property == "maxperiod") {
+        valid = readValue() && sensor.setMaxPeriod(value);
+    }
+    else if (property == "seed") {
+        if (readValue()) sensor.setSeed(value);
+        else valid = false;
+    }
+    else if (property == "databuffersize") {
+        if (!readValue()) {
+
+            valid = false;
         }
-        else if (property == "period") {
-            iss >> value;
-            sensor.setPeriod(value);
+        else if (!sensor.setBufferSize(value)) {
+
+            valid = false;
+            cout << "Invalid buffer size. Buffer size must be greater than 0.\n";
         }
-        else if (property == "minperiod") {
-            iss >> value;
-            sensor.setMinPeriod(value);
+    }
+    else if (property == "filtertype") {
+        valid = readValue() && processor.setFilterType(value);
+    }
+    else if (property == "filtersize") {
+        valid = readValue() && processor.setFilterSize(value);
+    }
+    else if (property == "numberofdatapoints") {
+        valid = readValue() && processor.setRawDataSize(value);
+    }
+    else if (property == "sketchaccuracy") {
+        valid = readValue() && processor.setSketchAccuracy(value);
+    }
+    else if (property == "sketchbuckets") {
+        valid = readValue() && processor.setSketchMaxBuckets(value);
+    }
+    else if (property == "publish") {
+        if (!readValue()) {
+
+            valid = false;
         }
-        else if (property == "maxperiod") {
-            iss >> value;
-            sensor.setMaxPeriod(value);
+        else if (value == 0) {
+
+            dataPublisher.stop();
+            cout << "Data publishing turned off.\n";
         }
-        else if (property == "databuffersize") {
-            iss >> value;
-            sensor.setBufferSize(value);
+        else if (value == 1) {
+
+            valid = dataPublisher.start(publishSocketPath);
+            if (valid) {
+
+                cout << "Data publishing turned on.\n";
+            }
         }
-        else if (property == "filtertype") {
-            iss >> value;
-            processor.setFilterType(value);
+        else {
+
+            valid = false;
+            cout << "Invalid publish value. 0 - Turn off, 1 - Turn on.\n";
         }
-        else if (property == "filtersize") {
-            iss >> value;
-            processor.setFilterSize(value);
+    }
+    else if (property == "export") {
+        if (!readValue()) {
+
+            valid = false;
         }
-        else if (property == "numberofdatapoints") {
-            iss >> value;
-            processor.setRawDataSize(value);
+        else if (value == 0) {
+
+            columnarExporter.stop();
+            cout << "Columnar export turned off.\n";
         }
-        else if (property == "pollingrate") {
-            iss >> value;
-            if (value > 0 && value < processorMaxPollingRate) {
+        else if (value == 1) {
 
-                processorPollingRate = value;
-                cout << "Polling rate successfully set.\n";
-            }
-            else {
+            valid = columnarExporter.start(exportPath);
+            if (valid) {
 
-                cout << "Invalid polling rate. Polling rate must be greater than 0 and less than " << processorMaxPollingRate;
+                cout << "Columnar export turned on.\n";
             }
         }
-        else if (property == "collectsize") {
-            iss >> value;
-            if (value > 0 && value < processorMaxCollectSize) {
+        else {
 
-                processorCollectSize = value;
-                cout << "Collect size successfully set.\n";
-            }
-            else {
+            valid = false;
+            cout << "Invalid export value. 0 - Turn off, 1 - Turn on.\n";
+        }
+    }
+    else if (property == "exportpath") {
+        string path;
+        iss >> path;
+        if (path.empty()) {
 
-                cout << "Invalid collect size. Collect size must be greater than 0 and less than " << processorMaxCollectSize;
+            valid = false;
+            cout << "Invalid export path.\n";
+        }
+        else {
 
-            }
+            // An active export keeps writing its file, the new path is used from the next start
+            exportPath = path;
+            cout << "Export path successfully set.\n";
         }
-        else if (property == "printdata") {
+    }
+    else if (property == "exportblock") {
+        valid = readValue() && columnarExporter.setBlockRows(value);
+    }
+    else if (property == "pollingrate") {
+        if (!readValue()) {
 
-            iss >> value;
-            if (value == 0) {
+            valid = false;
+        }
+        else if (value > 0 && value < processorMaxPollingRate) {
 
-                printDataStatistics = false;
-                cout << "Print data statistics turned off.\n";
-            }
-            else if (value == 1) {
+            processorPollingRate = value;
+            cout << "Polling rate successfully set.\n";
+        }
+        else {
 
-                printDataStatistics = true;
-                cout << "Print data statistics turned on.\n";
-            }
-            else {
+            valid = false;
+            cout << "Invalid polling rate. Polling rate must be greater than 0 and less than " << processorMaxPollingRate;
+        }
+    }
+    else if (property == "collectsize") {
+        if (!readValue()) {
 
-                cout << "Invalid print data value. 0 - Turn off, 1 - Turn on.\n";
-            }
+            valid = false;
+        }
+        else if (value > 0 && value < processorMaxCollectSize) {
+
+            processorCollectSize = value;
+            cout << "Collect size successfully set.\n";
         }
         else {
 
-            cout << "Unknown property: " << property << "\n";
+            valid = false;
+            cout << "Invalid collect size. Collect size must be greater than 0 and less than " << processorMaxCollectSize;
+
         }
+    }
+    else if (property == "adaptive") {
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (value == 0 || value == 1) {
+
+            adaptivePolling = value == 1;
+            pollingController.reset();
+            cout << "Adaptive polling turned " << (adaptivePolling ? "on.\n" : "off.\n");
+        }
+        else {
 
+            valid = false;
+            cout << "Invalid adaptive value. 0 - Turn off, 1 - Turn on.\n";
+        }
+    }
+    else if (property == "targetlatency") {
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (value > 1 && value < 2 * processorMaxPollingRate) {
+
+            pollingController.targetLatency = value;
+            cout << "Target latency successfully set.\n";
+        }
+        else {
+
+            valid = false;
+            cout << "Invalid target latency. Target latency must be greater than 1 and less than " << 2 * processorMaxPollingRate;
+        }
+    }
+    else if (property == "maxwakeups") {
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (value > 0 && value <= 1000) {
+
+            pollingController.maxWakeupsPerSecond = value;
+            cout << "Wakeup budget successfully set.\n";
+        }
+        else {
+
+            valid = false;
+            cout << "Invalid wakeup budget. Wakeups per second must be between 1 and 1000";
+        }
+    }
+    else if (property == "executor") {
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (shmRole != SHM_ROLE_NONE) {
+
+            valid = false;
+            cout << "The coroutine executor cannot be used with shared memory roles.\n";
+        }
+        else if (value == 0 || value == 1) {
+
+            // Only one mode may feed the processor, the processing thread does not lock it like the pipeline does.
+            // Whatever runs is stopped before switching.
+            bool wasRunning = interactivePipeline<dataType>() != nullptr || isGenerate;
+            stopPipeline<dataType>();
+            sensor.stopGeneration();
+            isGenerate = false;
+
+            useExecutor = value == 1;
+            cout << "Coroutine pipeline executor turned " << (useExecutor ? "on" : "off") << (wasRunning ? ", the simulation was stopped" : "") << ", it takes effect on the next start.\n";
+        }
+        else {
+
+            valid = false;
+            cout << "Invalid executor value. 0 - Threads, 1 - Coroutine executor.\n";
+        }
+    }
+    else if (property == "executorthreads") {
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (value > 0 && value <= 64) {
+
+            executorThreads = value;
+            cout << "Executor threads successfully set.\n";
+        }
+        else {
+
+            valid = false;
+            cout << "Invalid executor threads. Executor threads must be between 1 and 64";
+        }
+    }
+    else if (property == "spectrumsize") {
+        valid = readValue() && processor.setSpectrumSize(value);
+    }
+    else if (property == "spectrumoverlap") {
+        valid = readValue() && processor.setSpectrumOverlap(value);
+    }
+    else if (property == "sensorcpu") {
+        valid = readValue() && sensor.placement.setCpu(value);
+    }
+    else if (property == "processorcpu") {
+        valid = readValue() && processorPlacement.setCpu(value);
+    }
+    else if (property == "rtpriority") {
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (sensor.placement.setRealtimePriority(value)) {
+
+            processorPlacement.setRealtimePriority(value, true);
+        }
+        else {
+
+            valid = false;
+        }
+    }
+    else if (property == "rule") {
+        string type;
+        double threshold = 0.0;
+        iss >> type;
+        if (type == "clear") {
+
+            processor.clearAnomalyRules();
+        }
+        else if (!(iss >> threshold)) {
+
+            valid = false;
+            cout << "Invalid anomaly rule threshold, a number is expected.\n";
+        }
+        else {
+
+            valid = processor.addAnomalyRule(type, threshold);
+        }
+    }
+    else if (property == "synth") {
+        string type;
+        iss >> type;
+        if (type == "clear") {
+
+            sensor.clearSignalComponents();
+        }
+        else {
+
+            vector<double> parameters;
+            double parameter;
+            while (iss >> parameter) parameters.push_back(parameter);
+            valid = sensor.addSignalComponent(type, parameters);
+        }
+    }
+    else if (property == "printdata") {
+
+        if (!readValue()) {
+
+            valid = false;
+        }
+        else if (value == 0) {
+
+            printDataStatistics = false;
+            cout << "Print data statistics turned off.\n";
+        }
+        else if (value == 1) {
+
+            printDataStatistics = true;
+            cout << "Print data statistics turned on.\n";
+        }
+        else {
+
+            valid = false;
+            cout << "Invalid print data value. 0 - Turn off, 1 - Turn on.\n";
+        }
+    }
+    else {
+
+        cout << "Unknown property: " << property << "\n";
+        return false;
+    }
+
+    // Timing settings change the sample rate the spectrum is labelled with and the signal frequencies refer to
+    processor.setSpectrumSampleRate(sensorSampleRate(sensor));
+    sensor.setSignalSampleRate(sensorSampleRate(sensor));
+    return valid;
+}
+
+template <typename dataType>
+void processCommand(string& command, Sensor<dataType>& sensor, DataProcessor<dataType>& processor) {
+
+    clearLine(infoRow);
+    istringstream iss(command);
+    string action, property;
+    iss >> action;
+
+    if (action == "set") {
+
+        iss >> property;
+        applySetting(property, iss, sensor, processor);
     }
     else if (action == "start") {
 
-        sensor.startGeneration();
-        isGenerate = true;
-        cout << "Sensor simulation running. \n ";
+        if (useExecutor) {
+
+            startPipeline(sensor, processor);
+            cout << "Sensor pipeline running on the coroutine executor. \n ";
+            clearLine(commandRow);
+            displaySensorStatics(sensor);
+            displayProcessingStatics(processor);
+            return;
+        }
+
+        if (isGenerate) {
+
+            cout << "Sensor simulation is already running. \n ";
+        }
+        else {
+
+            // A processor process only starts consuming, its samples come from the sensor process.
+            // Starting a paused sensor resumes its generation thread instead of creating another one.
+            if (shmRole != SHM_ROLE_PROCESSOR) {
+
+                sensor.startGeneration();
+            }
+            isGenerate = true;
+            cout << "Sensor simulation running. \n ";
+        }
     }
     else if (action == "stop") {
 
+        stopPipeline<dataType>();
+        sensor.stopGeneration();
         isGenerate = false;
         cout << "Sensor simulation stopped. \n ";
     }
+    else if (action == "pause") {
+
+        if (useExecutor) {
+
+            cout << "Pause is not supported on the coroutine executor, use stop. \n ";
+        }
+        else if (!isGenerate) {
+
+            cout << "Sensor simulation is not running. \n ";
+        }
+        else {
+
+            sensor.pauseGeneration();
+            isGenerate = false;
+            cout << "Sensor simulation paused. \n ";
+        }
+    }
+    else if (action == "resume") {
+
+        if (useExecutor || isGenerate || (shmRole != SHM_ROLE_PROCESSOR && !sensor.isPaused())) {
+
+            cout << "Sensor simulation is not paused. \n ";
+        }
+        else {
+
+            sensor.resumeGeneration();
+            isGenerate = true;
+            cout << "Sensor simulation resumed. \n ";
+        }
+    }
+    else if (action == "simulate") {
+
+        int durationMs = 0;
+        iss >> durationMs;
+
+        if (isGenerate || sensor.isPaused()) {
+
+            cout << "Stop the sensor simulation before running a virtual-time simulation.\n";
+        }
+        else if (durationMs <= 0) {
+
+            cout << "Invalid duration. Usage: simulate <simulated milliseconds>\n";
+        }
+        else {
+
+            SimulationSummary summary = runVirtualSimulation(sensor, processor, durationMs);
+            displayStatistics(processor);
+
+            lock_guard<mutex> lock(printMutex);
+            clearLine(infoRow);
+            cout << "Simulated " << summary.simulatedMs << " ms in " << summary.wallMs << " ms: " << summary.generatedSamples << " samples, "
+                << summary.processedBatches << " batches, checksum " << hex << summary.checksum << dec << "\n";
+        }
+    }
     else if (action == "help") {
 
         cout << "HELP \n";
@@ -263,6 +1350,8 @@ void commandThread(Sensor<dataType>& sensor, DataProcessor<dataType>& processor)
         std::getline(std::cin, command);
 
         if (command == "exit") {
+            stopPipeline<dataType>();
+            sensor.stopGeneration();
             isRunning = false;
 
             // Use mutex to safely print the exit message
@@ -285,18 +1374,48 @@ void commandThread(Sensor<dataType>& sensor, DataProcessor<dataType>& processor)
 template <typename dataType>
 void processingThread(Sensor<dataType>& sensor, DataProcessor<dataType>& processor) {
 
+    vector<dataType> data;
+    auto startTime = chrono::steady_clock::now();
+
+    processorPlacement.apply();
+    processor.localizeBuffers();
+
     while (isRunning) {
 
-        if (isGenerate && sensor.isDataReady()) {
+        if (processorPlacement.applyIfChanged()) {
+
+            processor.localizeBuffers();
+            displayProcessingStatics(processor);
+        }
+
+        uint64_t nowMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+
+        if (isGenerate && shmRole == SHM_ROLE_PROCESSOR) {
 
-            vector<dataType> data = sensor.collectData(processorCollectSize);
-            if (!data.empty()) {
+            // Idle consumers sleep on the ring's futex instead of polling
+            adaptPolling(shmRing.getWrittenCount(), nowMs);
+            shmRing.waitForData(processorCollectSize, processorPollingRate);
+
+            data.clear();
+            if (shmRing.available() >= static_cast<uint64_t>(processorCollectSize) && shmRing.read(data, processorCollectSize) > 0) {
 
                 processor.inputData(data);
+                publishProcessedData(processor, data);
+                processedSamples += data.size();
+                processedBatches++;
                 displayStatistics(processor);
             }
+            continue;
+        }
+
+        if (isGenerate) {
+
+            adaptPolling(sensor.getGeneratedCount(), nowMs);
 
-            sensor.clearDataReady();
+            if (collectAndProcess(sensor, processor, data)) {
+
+                displayStatistics(processor);
+            }
         }
 
         this_thread::sleep_for(chrono::milliseconds(processorPollingRate));
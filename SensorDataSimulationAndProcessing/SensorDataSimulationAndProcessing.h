@@ -5,9 +5,15 @@
 
 #include <iostream>
 #include <sstream>
+#include <fstream>
 
 #include "Sensor.cpp"
 #include "DataProcessor.cpp"
+#include "DataPublisher.cpp"
+#include "ColumnarExporter.cpp"
+#include "SimulationClock.cpp"
+#include "AdaptiveController.cpp"
+#include "SensorPipeline.cpp"
 
 #include "console_utils.h"
 
@@ -16,33 +22,83 @@ std::mutex printMutex;
 atomic<bool> isRunning{ true };
 atomic<bool> isGenerate{ false };
 bool printDataStatistics = true;
+bool consoleOutput = true; // False in headless mode, where nothing is drawn on the console
+
+atomic<uint64_t> processedSamples{ 0 };
+atomic<uint64_t> processedBatches{ 0 };
 
 int processorPollingRate = 100; // 100 ms
 int processorCollectSize = 5; // Collect 20 data per polling
 int processorMaxPollingRate = 10000; // 10 seconds
 int processorMaxCollectSize = 1000; // Collect 1000 data per polling
 
+bool adaptivePolling = false; // Let the controller choose the polling rate and collect size
+AdaptivePollingController pollingController;
+
+bool useExecutor = false; // Run start/stop through the coroutine pipeline executor instead of the sensor and processing threads
+int executorThreads = 2;
+PipelineExecutor pipelineExecutor;
+
+DataPublisher dataPublisher;
+string publishSocketPath = "/tmp/SensorDataSimulationAndProcessing.sock";
+
+ColumnarExporter columnarExporter;
+string exportPath = "/tmp/SensorDataSimulationAndProcessing.sdcf";
+
+ShmRing shmRing;
+int shmRole = SHM_ROLE_NONE; // 0 - In-process, 1 - Sensor process, 2 - Processor process
+size_t shmRingCapacity = 65536;
+
+ThreadPlacement processorPlacement; // CPU and scheduling of the processing thread
+
 int configurationHeaderRow = 1;
-int statisticsHeaderRow = 14;
+int statisticsHeaderRow = 15;
 
 int sensorStaticsStartRow = 3;
-int sensorStaticsEndRow = 14;
+int sensorStaticsEndRow = 15;
 int sensorStaticsStartCol = 1;
 
 int processorStaticsStartRow = 3;
-int processorStaticsEndRow = 14;
+int processorStaticsEndRow = 15;
 int processorStaticsStartCol = 50;
 
-int rawStatisticsStartRow = 16;
-int rawStatisticsEndRow = 27;
+int rawStatisticsStartRow = 17;
+int rawStatisticsEndRow = 21;
 int rawStatisticsStartCol = 1;
 
-int filteredStatisticsStartRow = 16;
-int filteredStatisticsEndRow = 27;
+int filteredStatisticsStartRow = 17;
+int filteredStatisticsEndRow = 21;
 int filteredStatisticsStartCol = 50;
 
-int commandRow = 29;
-int infoRow = 28;
+int rawPercentilesStartRow = 23;
+int rawPercentilesEndRow = 26;
+int rawPercentilesStartCol = 1;
+
+int filteredPercentilesStartRow = 23;
+int filteredPercentilesEndRow = 26;
+int filteredPercentilesStartCol = 50;
+
+int controllerStartRow = 28;
+int controllerEndRow = 34;
+int controllerStartCol = 1;
+
+int anomalyStartRow = 28;
+int anomalyEndRow = 34;
+int anomalyStartCol = 50;
+
+int spectrumStartRow = 36;
+int spectrumEndRow = 40;
+int spectrumStartCol = 1;
+
+int bandEnergyStartRow = 36;
+int bandEnergyEndRow = 40;
+int bandEnergyStartCol = 50;
+
+int printDataStartRow = 42;
+int printDataEndRow = 46;
+
+int commandRow = 48;
+int infoRow = 47;
 
 template<typename dataType>
 void displaySensorStatics(Sensor<dataType>& sensor);
@@ -53,6 +109,65 @@ void displayProcessingStatics(DataProcessor<dataType>& processor);
 template<typename dataType>
 void displayStatistics(DataProcessor<dataType>& processor);
 
+struct SimulationSummary {
+
+    uint64_t simulatedMs = 0;
+    uint64_t wallMs = 0;
+    uint64_t generatedSamples = 0;
+    uint64_t processedSamples = 0;
+    uint64_t processedBatches = 0;
+    uint64_t checksum = 0; // FNV-1a hash of every processed batch and its filtered output
+};
+
+void adaptPolling(uint64_t generatedCount, uint64_t nowMs);
+
+template<typename dataType>
+double sensorSampleRate(Sensor<dataType>& sensor);
+
+template<typename dataType>
+bool collectAndProcess(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, vector<dataType>& data);
+
+struct RunOptions {
+
+    bool headless = false;
+    bool virtualTime = false;
+    uint64_t durationMs = 10000;
+    uint64_t maxSamples = 0;        // Stop after this many processed samples, 0 - no limit
+    string summaryPath;             // Empty - write the summary to stdout
+    bool publish = false;
+    string exportPath;              // --export, write processed data to this columnar file
+    string shmSensorName;           // --shm-sensor, run only the sensor and publish to this ring
+    string shmProcessorName;        // --shm-processor, run only the processor and consume from this ring
+    int pipelines = 0;              // Run this many independent pipelines on the coroutine executor
+    vector<string> settings;        // "property value" lines from --config files and --set options
+};
+
+template<typename dataType>
+SimulationSummary runVirtualSimulation(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, uint64_t durationMs, uint64_t maxSamples = 0);
+
+template<typename dataType>
+SimulationSummary runRealTime(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, uint64_t durationMs, uint64_t maxSamples);
+
+template<typename dataType>
+SimulationSummary runPipelines(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, RunOptions& options);
+
+template<typename dataType>
+void startPipeline(Sensor<dataType>& sensor, DataProcessor<dataType>& processor);
+
+template<typename dataType>
+void stopPipeline();
+
+bool parseArguments(int argc, char* argv[], RunOptions& options);
+
+template<typename dataType>
+int runHeadless(Sensor<dataType>& sensor, DataProcessor<dataType>& processor, RunOptions& options);
+
+template <typename dataType>
+bool applySetting(const string& property, istream& iss, Sensor<dataType>& sensor, DataProcessor<dataType>& processor);
+
+template<typename dataType>
+void publishProcessedData(DataProcessor<dataType>& processor, const vector<dataType>& data, const vector<int64_t>& timestamps = {});
+
 template <typename dataType>
 void processCommand(string& command, Sensor<dataType>& sensor, DataProcessor<dataType>& processor);
 
@@ -0,0 +1,1808 @@
+// SensorDataTests.cpp: Unit and property tests for Sensor, DataProcessor and the supporting components.
+// Property tests compare the real implementation with a naive reference model on many random inputs.
+// Usage: SensorDataTests [test name filter] [--seed N] [--trials N]
+
+#include <sstream>
+#include <deque>
+#include <map>
+#include <functional>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "Sensor.cpp"
+#include "DataProcessor.cpp"
+#include "SimulationClock.cpp"
+#include "ColumnarExporter.cpp"
+#include "PipelineExecutor.cpp"
+#include "DataPublisher.cpp"
+#include "AdaptiveController.cpp"
+#include "TestSupport.cpp"
+
+// The option and setting parsing of the application, without its main
+#define SENSOR_SIMULATION_NO_MAIN
+#include "SensorDataSimulationAndProcessing.cpp"
+
+using namespace std;
+
+namespace {
+
+    int failedChecks = 0;
+    uint32_t baseSeed = 20240601;
+    int trials = 200;
+
+    bool check(bool condition, const char* expression, const char* file, int line) {
+
+        if (!condition) {
+
+            failedChecks++;
+            cout << "    " << file << ":" << line << ": check failed: " << expression << "\n";
+        }
+
+        return condition;
+    }
+
+    #define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+    template<typename T>
+    vector<T> randomBatch(mt19937& random, size_t size) {
+
+        vector<T> batch(size);
+        for (T& value : batch) {
+
+            value = static_cast<T>(static_cast<int>(random() % 2001) - 1000) / (is_floating_point_v<T> ? static_cast<T>(8) : static_cast<T>(1));
+        }
+
+        return batch;
+    }
+
+    // Naive reference of the raw window and the moving average: keep everything, then take the tail
+    template<typename T>
+    struct ReferenceWindow {
+
+        size_t windowSize;
+        size_t filterSize;
+        vector<T> raw;
+        vector<double> filtered;
+
+        ReferenceWindow(size_t windowSize, size_t filterSize) : windowSize(windowSize), filterSize(filterSize), raw(windowSize, 0), filtered(windowSize, 0) {}
+
+        void input(const vector<T>& batch) {
+
+            raw.insert(raw.end(), batch.begin(), batch.end());
+            raw.erase(raw.begin(), raw.end() - windowSize);
+
+            double sum = 0;
+            for (size_t i = raw.size() - filterSize; i < raw.size(); i++) sum += raw[i];
+
+            filtered.push_back(sum / filterSize);
+            filtered.erase(filtered.begin());
+        }
+    };
+
+    template<typename T>
+    void rawWindowProperty(int filterType) {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            DataProcessor<T> processor;
+            size_t windowSize = 2 + random() % 60;
+            size_t filterSize = 1 + random() % (windowSize - 1);
+            {
+                QuietOutput quiet;
+                processor.setRawDataSize(static_cast<int>(windowSize));
+                processor.setFilterSize(static_cast<int>(filterSize));
+                processor.setFilterType(filterType);
+            }
+
+            ReferenceWindow<T> reference(windowSize, filterSize);
+
+            for (int step = 0; step < 100; step++) {
+
+                // Batch sizes cover empty, smaller, equal to and larger than the window
+                vector<T> batch = randomBatch<T>(random, random() % (2 * windowSize + 3));
+                processor.inputData(batch);
+                reference.input(batch);
+
+                bool same = CHECK(processor.getRawData() == reference.raw);
+
+                if (filterType == 0) {
+
+                    same = CHECK(processor.getFilteredData() == vector<double>(reference.raw.begin(), reference.raw.end())) && same;
+
+                    size_t latest = min(batch.size(), windowSize);
+                    same = CHECK(processor.getLatestFilteredData() == vector<double>(reference.raw.end() - latest, reference.raw.end())) && same;
+                }
+                else {
+
+                    same = CHECK(processor.getFilteredData() == reference.filtered) && same;
+                    same = CHECK(processor.getLatestFilteredData() == vector<double>(1, reference.filtered.back())) && same;
+                }
+
+                if (!same) {
+
+                    cout << "    seed " << seed << ", window " << windowSize << ", filter " << filterSize << ", step " << step << ", batch " << batch.size() << "\n";
+                    return;
+                }
+            }
+        }
+    }
+
+    void testRawWindowInt() { rawWindowProperty<int>(1); }
+    void testRawWindowDouble() { rawWindowProperty<double>(1); }
+    void testNoFilterWindow() { rawWindowProperty<double>(0); }
+
+    // Regression: an empty batch on a full window used to erase from end() + 1
+    void testEmptyBatchKeepsWindow() {
+
+        DataProcessor<int> processor;
+        processor.inputData({ 1, 2, 3 });
+        vector<int> before = processor.getRawData();
+
+        processor.inputData({});
+        CHECK(processor.getRawData() == before);
+        CHECK(processor.getRawData().size() == static_cast<size_t>(processor.rawDataSize));
+    }
+
+    void testSingleSampleShiftsWindow() {
+
+        DataProcessor<int> processor;
+        vector<int> expected(processor.rawDataSize, 0);
+
+        for (int value = 1; value <= 30; value++) {
+
+            processor.inputData({ value });
+            expected.erase(expected.begin());
+            expected.push_back(value);
+        }
+
+        CHECK(processor.getRawData() == expected);
+    }
+
+    void testMovingAverageStage() {
+
+        DataProcessor<int> processor;
+        processor.inputData({ 10, 20, 30, 40, 50 });
+        vector<double> before = processor.getFilteredData();
+
+        // Running the stage again appends the same average of the unchanged window
+        DataProcessorProbe<int>::movingAverageFilter(processor);
+        vector<double> after = processor.getFilteredData();
+
+        CHECK(after.size() == before.size());
+        CHECK(after.back() == 30.0);
+        CHECK(vector<double>(after.begin(), after.end() - 1) == vector<double>(before.begin() + 1, before.end()));
+    }
+
+    void testSubsetAverages() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            DataProcessor<int> processor;
+            size_t windowSize = 2 + random() % 60;
+            {
+                QuietOutput quiet;
+                processor.setRawDataSize(static_cast<int>(windowSize));
+            }
+            processor.inputData(randomBatch<int>(random, windowSize));
+
+            int subsetSize = static_cast<int>(random() % (windowSize + 3));
+            processor.calculateSubsetAverages(subsetSize);
+
+            vector<int> raw = processor.getRawData();
+            vector<double> expected;
+            for (size_t i = 0; subsetSize > 0 && i + subsetSize <= raw.size(); i += subsetSize) {
+
+                double sum = 0;
+                for (int j = 0; j < subsetSize; j++) sum += raw[i + j];
+                expected.push_back(sum / subsetSize);
+            }
+
+            if (!CHECK(processor.getSubsetAverages() == expected)) {
+
+                cout << "    seed " << seed << ", window " << windowSize << ", subset " << subsetSize << "\n";
+                return;
+            }
+        }
+    }
+
+    void testSensorCollectData() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            Sensor<double> sensor;
+            Sensor<double> reference;
+            {
+                QuietOutput quiet;
+                sensor.setSeed(seed);
+                reference.setSeed(seed);
+            }
+
+            int collectSize = 1 + random() % 20;
+            int generated = random() % 40;
+            sensor.setBufferSize(collectSize);
+
+            vector<double> sequence;
+            for (int i = 0; i < generated; i++) {
+
+                sensor.generateOnce();
+                sequence.push_back(reference.nextDataPoint());
+            }
+
+            vector<double> expected;
+            if (generated >= collectSize) expected.assign(sequence.end() - collectSize, sequence.end());
+
+            if (!CHECK(sensor.collectData(collectSize) == expected) || !CHECK(sensor.getGeneratedCount() == static_cast<uint64_t>(generated))) {
+
+                cout << "    seed " << seed << ", collect " << collectSize << ", generated " << generated << "\n";
+                return;
+            }
+        }
+    }
+
+    void testSensorSeedReproducible() {
+
+        Sensor<int> first;
+        Sensor<int> second;
+        {
+            QuietOutput quiet;
+            first.setTiming(ASYNCHRONOUS);
+            second.setTiming(ASYNCHRONOUS);
+            first.setSeed(42);
+            second.setSeed(42);
+        }
+
+        for (int i = 0; i < 1000; i++) {
+
+            int value = first.nextDataPoint();
+            CHECK(value == second.nextDataPoint());
+            CHECK(value >= first.lowerBound && value <= first.upperBound);
+
+            int delay = first.nextDelay();
+            CHECK(delay == second.nextDelay());
+            CHECK(delay >= first.minPeriod && delay <= first.maxPeriod);
+        }
+    }
+
+    // Asynchronous delays are drawn by rejection from the raw engine output, the same on every standard library
+    void testSensorDelayRejection() {
+
+        Sensor<int> sensor;
+        {
+            QuietOutput quiet;
+            sensor.setTiming(ASYNCHRONOUS);
+            sensor.setMinPeriod(1);
+            sensor.setMaxPeriod(1 + (1 << 30)); // A range of 2^30 + 1 rejects a quarter of the engine outputs
+            sensor.setSeed(baseSeed);
+        }
+
+        mt19937 reference(baseSeed);
+        uint64_t range = (1ULL << 30) + 1;
+        uint64_t limit = (1ULL << 32) / range * range;
+
+        for (int i = 0; i < 1000; i++) {
+
+            uint64_t value;
+            do value = reference(); while (value >= limit);
+
+            if (!CHECK(sensor.nextDelay() == 1 + static_cast<int>(value % range))) return;
+        }
+
+        // A minimum above the maximum or a maximum below the minimum is rejected, so the range never becomes empty
+        bool minAccepted, maxAccepted, equalAccepted;
+        {
+            QuietOutput quiet;
+            minAccepted = sensor.setMinPeriod(2 + (1 << 30));
+            maxAccepted = sensor.setMaxPeriod(1);
+            equalAccepted = sensor.setMinPeriod(1 + (1 << 30));
+        }
+        CHECK(!minAccepted && !maxAccepted && !equalAccepted);
+        CHECK(sensor.minPeriod == 1 && sensor.maxPeriod == 1 + (1 << 30));
+        CHECK(sensor.nextDelay() >= 1);
+    }
+
+    void testSignalSynthesizer() {
+
+        const double pi = acos(-1.0);
+
+        // Waveforms against their closed forms. The table interpolation and the rounded phase increment stay far below 1e-4.
+        SignalSynthesizer waves;
+        waves.setSampleRate(1000.0);
+        CHECK(waves.addComponent(SIGNAL_SINE, { 3.0, 50.0 }));
+        CHECK(waves.addComponent(SIGNAL_OFFSET, { 7.0 }));
+        CHECK(waves.addComponent(SIGNAL_DRIFT, { 2.0 }));
+
+        vector<double> samples(5000);
+        waves.generate(samples.data(), samples.size());
+        bool same = true;
+        for (size_t n = 0; n < samples.size() && same; n++) {
+
+            same = CHECK(fabs(samples[n] - (3.0 * sin(2.0 * pi * 50.0 * n / 1000.0) + 7.0 + 2.0 * n / 1000.0)) < 1e-4);
+        }
+
+        SignalSynthesizer square;
+        square.setSampleRate(1000.0);
+        CHECK(square.addComponent(SIGNAL_SQUARE, { 2.0, 10.0 }));
+        square.generate(samples.data(), 200);
+        CHECK(samples[0] == 2.0 && samples[49] == 2.0 && samples[51] == -2.0 && samples[99] == -2.0 && samples[101] == 2.0);
+
+        // Noise has the requested standard deviation, spikes and dropouts their rates and lengths
+        SignalSynthesizer noise;
+        CHECK(noise.addComponent(SIGNAL_NOISE, { 4.0 }));
+        samples.assign(200000, 0.0);
+        noise.generate(samples.data(), samples.size());
+        double mean = accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        double variance = 0.0;
+        for (double value : samples) variance += (value - mean) * (value - mean);
+        CHECK(fabs(mean) < 0.05 && fabs(sqrt(variance / samples.size()) - 4.0) < 0.05);
+
+        SignalSynthesizer events;
+        CHECK(events.addComponent(SIGNAL_OFFSET, { 1.0 }));
+        CHECK(events.addComponent(SIGNAL_SPIKES, { 0.01, 100.0 }));
+        CHECK(events.addComponent(SIGNAL_DROPOUTS, { 0.001, 10.0 }));
+        events.generate(samples.data(), samples.size());
+
+        size_t spikes = 0, dropped = 0, run = 0;
+        bool runsComplete = true;
+        for (double value : samples) {
+
+            spikes += fabs(value) > 50.0;
+            dropped += value == 0.0;
+            if (value == 0.0) run++;
+            else {
+
+                runsComplete = runsComplete && run % 10 == 0; // Back to back dropouts join into longer runs
+                run = 0;
+            }
+        }
+        CHECK(spikes > 1700 && spikes < 2300);
+        CHECK(dropped > 1400 && dropped < 2600 && runsComplete);
+
+        // A seed reproduces the signal whether it is read in blocks or one sample at a time
+        SignalSynthesizer blocks, single;
+        for (SignalSynthesizer* synthesizer : { &blocks, &single }) {
+
+            synthesizer->setSampleRate(100.0);
+            synthesizer->addComponent(SIGNAL_CHIRP, { 1.0, 1.0, 40.0, 3.0 });
+            synthesizer->addComponent(SIGNAL_NOISE, { 0.5 });
+            synthesizer->addComponent(SIGNAL_DROPOUTS, { 0.01, 4.0 });
+            synthesizer->reset(99);
+        }
+
+        samples.assign(1000, 0.0);
+        blocks.generate(samples.data(), 300);
+        blocks.generate(samples.data() + 300, 700);
+        same = true;
+        for (size_t n = 0; n < samples.size() && same; n++) same = CHECK(single.next() == samples[n]);
+
+        // A change after a partial block continues right after the last sample next() served
+        vector<double> changed(600);
+        blocks.generate(changed.data(), 100);
+        for (size_t n = 0; n < 100; n++) samples[n] = single.next();
+        for (SignalSynthesizer* synthesizer : { &blocks, &single }) {
+
+            synthesizer->addComponent(SIGNAL_OFFSET, { 5.0 });
+            synthesizer->setSampleRate(200.0);
+        }
+        blocks.generate(changed.data() + 100, 500);
+        for (size_t n = 100; n < 300; n++) samples[n] = single.next();
+        single.generate(samples.data() + 300, 300);
+        CHECK(equal(changed.begin(), changed.end(), samples.begin()));
+
+        // Bursts keep the average rate
+        SignalSynthesizer bursts;
+        CHECK(bursts.addComponent(SIGNAL_BURSTS, { 4.0 }));
+        vector<int> delays;
+        for (int i = 0; i < 8; i++) delays.push_back(bursts.arrivalDelay(10));
+        CHECK(delays == vector<int>({ 0, 0, 0, 40, 0, 0, 0, 40 }));
+
+        CHECK(!bursts.addComponent(SIGNAL_SINE, { 1.0 }));
+        CHECK(!bursts.addComponent(SIGNAL_SPIKES, { 1.5, 1.0 }));
+        CHECK(!bursts.addComponent(SIGNAL_CHIRP, { 1.0, 1.0, 2.0, 0.0 }));
+        CHECK(!bursts.addComponent(SIGNAL_COMPONENT_TYPES, {}));
+    }
+
+    // Waits up to a second for the generated count to pass the given value
+    bool waitForGenerated(Sensor<int>& sensor, uint64_t count) {
+
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+        while (sensor.getGeneratedCount() <= count && chrono::steady_clock::now() < deadline) {
+
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        return sensor.getGeneratedCount() > count;
+    }
+
+    void testSensorLifecycle() {
+
+        Sensor<int> sensor;
+        {
+            QuietOutput quiet;
+            sensor.setPeriod(1);
+        }
+
+        // Repeated start and stop cycles, a second start while running must not add a thread
+        for (int cycle = 0; cycle < 20; cycle++) {
+
+            uint64_t before = sensor.getGeneratedCount();
+            sensor.startGeneration();
+            sensor.startGeneration();
+            CHECK(sensor.isGenerating());
+            CHECK(waitForGenerated(sensor, before));
+
+            sensor.stopGeneration();
+            CHECK(!sensor.isGenerating() && !sensor.isPaused());
+
+            uint64_t stopped = sensor.getGeneratedCount();
+            this_thread::sleep_for(chrono::milliseconds(3));
+            CHECK(sensor.getGeneratedCount() == stopped);
+        }
+
+        // Pause halts generation, resume continues on the same thread
+        sensor.startGeneration();
+        CHECK(waitForGenerated(sensor, sensor.getGeneratedCount()));
+        sensor.pauseGeneration();
+        CHECK(sensor.isPaused());
+
+        uint64_t paused = sensor.getGeneratedCount();
+        this_thread::sleep_for(chrono::milliseconds(5));
+        CHECK(sensor.getGeneratedCount() == paused);
+
+        sensor.resumeGeneration();
+        CHECK(sensor.isGenerating());
+        CHECK(waitForGenerated(sensor, paused));
+
+        // Stop cancels the sleep of a long period instead of waiting for it
+        {
+            QuietOutput quiet;
+            sensor.setPeriod(10000);
+        }
+        this_thread::sleep_for(chrono::milliseconds(5));
+
+        auto start = chrono::steady_clock::now();
+        sensor.stopGeneration();
+        CHECK(chrono::steady_clock::now() - start < chrono::seconds(1));
+        CHECK(!sensor.isGenerating());
+    }
+
+    void testSketchAccuracy() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            double accuracy = 0.005 + (random() % 5) * 0.01;
+            QuantileSketch sketch(accuracy, 2048);
+
+            vector<double> values(1 + random() % 2000);
+            for (double& value : values) {
+
+                // Both signs, zeros and several orders of magnitude
+                double magnitude = pow(10.0, (random() % 8000) / 1000.0 - 2.0);
+                int sign = random() % 5;
+                value = sign == 0 ? 0.0 : sign % 2 == 0 ? -magnitude : magnitude;
+                sketch.add(value);
+            }
+
+            sort(values.begin(), values.end());
+
+            for (double q : { 0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 1.0 }) {
+
+                double exact = values[static_cast<size_t>(q * (values.size() - 1))];
+                double estimate = sketch.getQuantile(q);
+
+                if (!CHECK(fabs(estimate - exact) <= accuracy * fabs(exact) * (1.0 + 1e-9))) {
+
+                    cout << "    seed " << seed << ", q " << q << ", exact " << exact << ", estimate " << estimate << "\n";
+                    return;
+                }
+            }
+        }
+    }
+
+    void testSketchMerge() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            QuantileSketch left, right, all;
+            for (int i = 0, n = random() % 500; i < n; i++) {
+
+                double value = static_cast<int>(random() % 20001) - 10000;
+                (random() % 2 ? left : right).add(value);
+                all.add(value);
+            }
+
+            CHECK(left.merge(right));
+            CHECK(left.getCount() == all.getCount());
+
+            for (double q = 0.0; q <= 1.0; q += 0.05) {
+
+                if (!CHECK(left.getQuantile(q) == all.getQuantile(q))) {
+
+                    cout << "    seed " << seed << ", q " << q << "\n";
+                    return;
+                }
+            }
+        }
+    }
+
+    // Overlapping collectData batches must feed the sketches every sample exactly once
+    void testSketchOverlappingBatches() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            int collectSize = 2 + random() % 10;
+
+            Sensor<int> sensor;
+            DataProcessor<int> overlapping, disjoint;
+            {
+                QuietOutput quiet;
+                sensor.setSeed(seed);
+                overlapping.setRawDataSize(500);
+                disjoint.setRawDataSize(500);
+            }
+
+            vector<int> pending;
+            for (int poll = 0, polls = 1 + random() % 60; poll < polls; poll++) {
+
+                for (int i = 0, n = random() % (2 * collectSize); i < n; i++) sensor.generateOnce();
+
+                vector<int> batch = sensor.collectData(collectSize);
+                if (batch.empty()) continue;
+
+                size_t newCount = sensor.getNewDataCount();
+                overlapping.inputData(batch, newCount);
+                disjoint.inputData(vector<int>(batch.end() - newCount, batch.end()));
+            }
+
+            for (double q : { 0.0, 0.1, 0.5, 0.9, 0.99, 1.0 }) {
+
+                if (!CHECK(overlapping.getRawPercentile(q) == disjoint.getRawPercentile(q))) {
+
+                    cout << "    seed " << seed << ", q " << q << "\n";
+                    return;
+                }
+            }
+        }
+    }
+
+    void testSensorNewDataCount() {
+
+        Sensor<int> sensor;
+        sensor.setBufferSize(5);
+
+        for (int i = 0; i < 3; i++) sensor.generateOnce();
+        CHECK(sensor.collectData(5).empty());
+
+        for (int i = 0; i < 2; i++) sensor.generateOnce();
+        CHECK(sensor.collectData(5).size() == 5);
+        CHECK(sensor.getNewDataCount() == 5);
+
+        for (int i = 0; i < 2; i++) sensor.generateOnce();
+        CHECK(sensor.collectData(5).size() == 5);
+        CHECK(sensor.getNewDataCount() == 2);
+
+        sensor.collectData(5);
+        CHECK(sensor.getNewDataCount() == 0);
+
+        // Samples that slid out of the buffer between two polls are lost, at most the whole buffer is new
+        for (int i = 0; i < 12; i++) sensor.generateOnce();
+        sensor.collectData(5);
+        CHECK(sensor.getNewDataCount() == 5);
+    }
+
+    void testSensorSignal() {
+
+        QuietOutput quiet;
+
+        // A bulk block leaves the same buffer as one sample at a time
+        Sensor<double> bulk, single;
+        for (Sensor<double>* sensor : { &bulk, &single }) {
+
+            sensor->setBufferSize(5);
+            sensor->setValueType(SYNTHESIZED);
+            sensor->setSignalSampleRate(100.0);
+            sensor->addSignalComponent("offset", { 55.0 });
+            sensor->addSignalComponent("sine", { 60.0, 3.0 });
+        }
+
+        bulk.generateBlock(12);
+        for (int i = 0; i < 12; i++) single.generateOnce();
+        vector<double> data = bulk.collectData(5);
+        CHECK(data.size() == 5 && data == single.collectData(5));
+        CHECK(bulk.getGeneratedCount() == 12 && bulk.getNewDataCount() == 5);
+
+        // The signal swings from -5 to 115, in range mode it saturates at the bounds
+        bulk.setBufferSize(100);
+        bulk.generateBlock(100);
+        data = bulk.collectData(100);
+        CHECK(data.size() == 100);
+        CHECK(*min_element(data.begin(), data.end()) == bulk.lowerBound && *max_element(data.begin(), data.end()) == bulk.upperBound);
+
+        bulk.setLimit(UNBOUNDED);
+        bulk.generateBlock(100);
+        data = bulk.collectData(100);
+        CHECK(*min_element(data.begin(), data.end()) < bulk.lowerBound && *max_element(data.begin(), data.end()) > bulk.upperBound);
+    }
+
+    // Naive anomaly reference: rescans the window with exact two-pass statistics for every sample and emits in the
+    // detector's block order
+    struct ReferenceDetector {
+
+        vector<AnomalyRule> rules;
+        size_t windowSize;
+        deque<double> history;
+        bool hasPrevious = false;
+        double previous = 0.0;
+        uint64_t sampleIndex = 0;
+        vector<AnomalyEvent> events;
+
+        bool fires(const AnomalyRule& rule, double value, double delta, double mean, double deviation) {
+
+            switch (rule.type) {
+
+            case RULE_ABOVE: return value > rule.threshold;
+            case RULE_BELOW: return value < rule.threshold;
+            case RULE_RATE: return fabs(delta) > rule.threshold;
+            case RULE_ZSCORE: return fabs(value - mean) > rule.threshold * deviation;
+            default: return false;
+            }
+        }
+
+        void evaluate(const vector<int>& batch) {
+
+            for (size_t start = 0; start < batch.size(); start += ANOMALY_BLOCK_SIZE) {
+
+                size_t count = min<size_t>(ANOMALY_BLOCK_SIZE, batch.size() - start);
+                vector<double> deltas, means, deviations;
+
+                for (size_t i = 0; i < count; i++) {
+
+                    double value = batch[start + i];
+                    deltas.push_back(hasPrevious ? value - previous : 0.0);
+
+                    if (history.size() > 1) {
+
+                        double sum = 0.0, squaredDeviations = 0.0;
+                        for (double old : history) sum += old;
+                        double mean = sum / history.size();
+                        for (double old : history) squaredDeviations += (old - mean) * (old - mean);
+
+                        means.push_back(mean);
+                        deviations.push_back(sqrt(squaredDeviations / history.size()));
+                    }
+                    else {
+
+                        means.push_back(value);
+                        deviations.push_back(INFINITY);
+                    }
+
+                    history.push_back(value);
+                    if (history.size() > windowSize) history.pop_front();
+                    previous = value;
+                    hasPrevious = true;
+                }
+
+                for (size_t rule = 0; rule < rules.size(); rule++) {
+
+                    for (size_t i = 0; i < count; i++) {
+
+                        double value = batch[start + i];
+                        if (fires(rules[rule], value, deltas[i], means[i], deviations[i])) {
+
+                            events.push_back({ 0, sampleIndex + i, static_cast<int>(rule), rules[rule].type, rules[rule].threshold, value });
+                        }
+                    }
+                }
+
+                sampleIndex += count;
+            }
+        }
+    };
+
+    void testAnomalyDetector() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            size_t windowSize = 1 + random() % 80;
+            AnomalyDetector detector(windowSize);
+            ReferenceDetector reference;
+            reference.windowSize = windowSize;
+
+            for (int i = 0, n = 1 + random() % 4; i < n; i++) {
+
+                AnomalyRule rule{ static_cast<int>(random() % 4), 0.0 };
+                rule.threshold = rule.type == RULE_ZSCORE ? 0.5 + (random() % 30) / 10.0 : rule.type == RULE_RATE ? 1.0 + random() % 1500 : static_cast<int>(random() % 2001) - 1000.0;
+
+                CHECK(detector.addRule(rule.type, rule.threshold));
+                reference.rules.push_back(rule);
+            }
+
+            for (int step = 0; step < 50; step++) {
+
+                vector<int> batch = randomBatch<int>(random, random() % 150);
+                detector.evaluate(batch, 0);
+                reference.evaluate(batch);
+            }
+
+            bool same = CHECK(detector.getTotalEvents() == reference.events.size());
+
+            const deque<AnomalyEvent>& recent = detector.getRecentEvents();
+            size_t offset = reference.events.size() - min(reference.events.size(), recent.size());
+            for (size_t i = 0; same && i < recent.size(); i++) {
+
+                const AnomalyEvent& expected = reference.events[offset + i];
+                same = CHECK(recent[i].sampleIndex == expected.sampleIndex && recent[i].ruleIndex == expected.ruleIndex && recent[i].ruleType == expected.ruleType
+                    && recent[i].threshold == expected.threshold && recent[i].value == expected.value);
+            }
+
+            if (!same) {
+
+                cout << "    seed " << seed << ", window " << windowSize << "\n";
+                return;
+            }
+        }
+
+        AnomalyDetector detector;
+        CHECK(!detector.addRule(RULE_ZSCORE, 0.0));
+        CHECK(!detector.addRule(7, 1.0));
+    }
+
+    // A small signal on a large offset, where a running sum of squares loses every digit of the variance
+    void testAnomalyPrecision() {
+
+        const size_t windowSize = 64;
+        AnomalyDetector detector(windowSize);
+        detector.addRule(RULE_ZSCORE, 3.0);
+
+        mt19937 random(baseSeed);
+        deque<double> window;
+        uint64_t warmupEvents = 0;
+
+        for (int step = 0; step < 2000; step++) {
+
+            // The first samples of a filling window have a tiny deviation and may fire
+            if (step == 10) warmupEvents = detector.getTotalEvents();
+
+            vector<double> batch = randomBatch<double>(random, 50);
+            for (double& value : batch) value = 1e6 + value / 1000.0;
+            detector.evaluate(batch, 0);
+
+            for (double value : batch) {
+
+                window.push_back(value);
+                if (window.size() > windowSize) window.pop_front();
+            }
+        }
+
+        double sum = 0.0, squaredDeviations = 0.0;
+        for (double value : window) sum += value;
+        double mean = sum / window.size();
+        for (double value : window) squaredDeviations += (value - mean) * (value - mean);
+        double deviation = sqrt(squaredDeviations / window.size());
+
+        CHECK(fabs(detector.getRollingMean() - mean) < 1e-9);
+        CHECK(fabs(detector.getRollingDeviation() - deviation) < 1e-6 * deviation);
+
+        // Uniform noise never reaches 3 standard deviations from the mean of a full window
+        CHECK(detector.getTotalEvents() == warmupEvents);
+    }
+
+    // After the rules are cleared, the recorded events still name the rule they matched
+    void testAnomalyEventRules() {
+
+        DataProcessor<double> processor;
+        {
+            QuietOutput quiet;
+            processor.setFilterType(0);
+            processor.addAnomalyRule("above", 10.0);
+        }
+
+        processor.inputData({ 1.0, 20.0, 30.0 }, 1);
+        const vector<AnomalyEvent>& latest = processor.getAnomalyDetector().getLatestEvents();
+        bool fired = CHECK(latest.size() == 1);
+        if (fired) CHECK(latest[0].value == 30.0 && latest[0].ruleType == RULE_ABOVE && latest[0].threshold == 10.0);
+
+        {
+            QuietOutput quiet;
+            processor.clearAnomalyRules();
+            processor.addAnomalyRule("below", -5.0);
+        }
+
+        // Overlapping batches are evaluated once per sample
+        processor.inputData({ 20.0, 30.0, -10.0 }, 1);
+        processor.inputData({ 30.0, -10.0, 0.0 }, 1);
+        CHECK(processor.getAnomalyDetector().getTotalEvents() == 2);
+
+        const deque<AnomalyEvent>& recent = processor.getAnomalyDetector().getRecentEvents();
+        fired = CHECK(recent.size() == 2);
+        if (fired) {
+
+            CHECK(recent[0].ruleType == RULE_ABOVE && recent[0].threshold == 10.0);
+            CHECK(recent[1].ruleType == RULE_BELOW && recent[1].value == -10.0);
+        }
+        CHECK(processor.getAnomalyDetector().getLatestEvents().empty());
+    }
+
+    // The command thread changes the configuration while the processing thread feeds batches. A race rebuilds the
+    // vectors under the running evaluation, which crashes or shows up with -fsanitize=thread.
+    void testProcessorReconfiguration() {
+
+        DataProcessor<double> processor;
+        mt19937 random(baseSeed);
+        size_t events = 0;
+        {
+            QuietOutput quiet;
+            atomic<bool> done{ false };
+
+            thread commands([&processor, &done] {
+
+                for (int i = 0; !done; i++) {
+
+                    processor.addAnomalyRule(i % 2 ? "above" : "zscore", 1.0 + i % 5);
+                    if (i % 16 == 15) processor.clearAnomalyRules();
+                    processor.setSpectrumSize(i % 3 ? 64 : 128);
+                    processor.setSpectrumOverlap(i % 90);
+                    processor.setSpectrumSampleRate(100.0 + i % 7);
+                }
+            });
+
+            for (int batch = 0; batch < 20000; batch++) {
+
+                processor.inputData(randomBatch<double>(random, 8), 1 + batch % 8);
+                events += processor.getAnomalyDetector().getLatestEvents().size();
+            }
+
+            done = true;
+            commands.join();
+        }
+
+        CHECK(events > 0);
+    }
+
+    void testRealTransform() {
+
+        const double pi = acos(-1.0);
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+
+            size_t frameSize = size_t(1) << (3 + random() % 8);
+            SpectralAnalyzer analyzer(frameSize, frameSize);
+
+            vector<double> input(frameSize);
+            for (double& value : input) value = static_cast<int>(random() % 2001) / 100.0 - 10.0;
+
+            vector<complex<double>> output;
+            analyzer.realTransform(input.data(), output);
+
+            // Naive DFT as the reference
+            double tolerance = 1e-9 * frameSize * 10.0;
+            bool same = CHECK(output.size() == frameSize / 2 + 1);
+            for (size_t k = 0; same && k <= frameSize / 2; k++) {
+
+                complex<double> expected = 0.0;
+                for (size_t n = 0; n < frameSize; n++) expected += input[n] * polar(1.0, -2.0 * pi * k * n / frameSize);
+
+                same = CHECK(abs(output[k] - expected) <= tolerance);
+            }
+
+            if (!same) {
+
+                cout << "    seed " << seed << ", frame " << frameSize << "\n";
+                return;
+            }
+        }
+    }
+
+    // Overlapping batches from the sliding sensor buffer must not repeat samples in the spectrum
+    void testSpectrumOverlappingBatches() {
+
+        const double pi = acos(-1.0);
+        DataProcessor<double> processor;
+        {
+            QuietOutput quiet;
+            processor.setSpectrumSize(64);
+        }
+        processor.setSpectrumSampleRate(1000.0);
+
+        // A 125 Hz tone sampled at 1000 samples/s falls on bin 8, batches of 5 samples advance by 2
+        vector<double> stream(4000);
+        for (size_t n = 0; n < stream.size(); n++) stream[n] = sin(2.0 * pi * 125.0 * n / 1000.0);
+
+        for (size_t end = 5; end <= stream.size(); end += 2) {
+
+            processor.inputData(vector<double>(stream.begin() + end - 5, stream.begin() + end), end == 5 ? 5 : 2);
+        }
+
+        SpectralAnalyzer& spectrum = processor.getSpectralAnalyzer();
+        CHECK(spectrum.getFrameCount() > 0);
+        CHECK(fabs(spectrum.getDominantFrequency() - 125.0) < 1000.0 / 64);
+    }
+
+    void testSpectralStatistics() {
+
+        const double pi = acos(-1.0);
+        SpectralAnalyzer analyzer(256, 64);
+        analyzer.setSampleRate(1000.0);
+
+        // 1000 samples/s with a 60 Hz tone
+        vector<double> tone(2000);
+        for (size_t n = 0; n < tone.size(); n++) tone[n] = 5.0 + sin(2.0 * pi * 60.0 * n / 1000.0);
+
+        analyzer.addSamples(tone);
+        CHECK(analyzer.getFrameCount() == (tone.size() - 256) / 64 + 1);
+        CHECK(fabs(analyzer.getDominantFrequency() - 60.0) < 1000.0 / 256);
+        CHECK(analyzer.getSpectralFlatness() < 0.05);
+        CHECK(analyzer.getBandEnergy(0) > 0.9);
+
+        // White noise is flat and spreads its energy over every band
+        mt19937 random(baseSeed);
+        vector<double> noise(4000);
+        for (double& value : noise) value = static_cast<int>(random() % 2001) - 1000.0;
+
+        CHECK(analyzer.configure(256, 128));
+        analyzer.addSamples(noise);
+        CHECK(analyzer.getSpectralFlatness() > 0.4);
+        for (int band = 0; band < SPECTRAL_BANDS; band++) CHECK(analyzer.getBandEnergy(band) > 0.1);
+
+        // Feeding the samples one by one gives the same frames as one large batch
+        SpectralAnalyzer batched(64, 16), single(64, 16);
+        batched.addSamples(tone);
+        for (double value : tone) single.addSamples(vector<double>{ value });
+        CHECK(batched.getFrameCount() == single.getFrameCount());
+        CHECK(batched.getAveragedPower() == single.getAveragedPower());
+
+        CHECK(!analyzer.configure(100, 10));
+        CHECK(!analyzer.configure(64, 0));
+        CHECK(analyzer.configure(0, 0) && !analyzer.isEnabled());
+    }
+
+    void testColumnarCodec() {
+
+        for (int trial = 0; trial < trials; trial++) {
+
+            uint32_t seed = baseSeed + trial;
+            mt19937 random(seed);
+            size_t count = 1 + random() % 500;
+
+            // Mostly periodic timestamps with jitter and the occasional jump backwards
+            vector<int64_t> timestamps(count);
+            int64_t timestamp = static_cast<int64_t>(random()) << 20;
+            for (int64_t& value : timestamps) {
+
+                timestamp += random() % 4 == 0 ? static_cast<int64_t>(random() % 2000001) - 1000000 : 1000000;
+                value = timestamp;
+            }
+
+            // Repeats, small steps, integers, sign changes, NaN and infinity
+            vector<double> values(count);
+            uniform_real_distribution<double> uniform(-1000.0, 1000.0);
+            for (size_t i = 0; i < count; i++) {
+
+                switch (random() % 6) {
+                case 0: values[i] = i > 0 ? values[i - 1] : 0.0; break;
+                case 1: values[i] = i > 0 ? values[i - 1] + 0.125 : 1.0; break;
+                case 2: values[i] = static_cast<int>(random() % 201) - 100; break;
+                case 3: values[i] = uniform(random); break;
+                case 4: values[i] = random() % 2 == 0 ? numeric_limits<double>::quiet_NaN() : -numeric_limits<double>::infinity(); break;
+                default: values[i] = uniform(random) * 1e-300; break;
+                }
+            }
+
+            vector<uint8_t> encodedTimestamps, encodedValues;
+            ColumnarCodec::encodeTimestamps(timestamps, encodedTimestamps);
+            ColumnarCodec::encodeValues(values, encodedValues);
+
+            vector<int64_t> decodedTimestamps;
+            vector<double> decodedValues;
+            bool decoded = CHECK(ColumnarCodec::decodeTimestamps(encodedTimestamps.data(), encodedTimestamps.size(), count, decodedTimestamps))
+                && CHECK(ColumnarCodec::decodeValues(encodedValues.data(), encodedValues.size(), count, decodedValues));
+
+            // Compared bit for bit, NaN payloads included
+            bool same = decoded && CHECK(decodedTimestamps == timestamps)
+                && CHECK(memcmp(decodedValues.data(), values.data(), count * sizeof(double)) == 0);
+
+            if (!same) {
+
+                cout << "    seed " << seed << ", count " << count << "\n";
+                return;
+            }
+        }
+
+        // A periodic stream of a constant compresses to about a byte per timestamp and a bit per value
+        vector<int64_t> periodic(1000);
+        for (size_t i = 0; i < periodic.size(); i++) periodic[i] = 1700000000000000000LL + static_cast<int64_t>(i) * 1000000;
+
+        vector<uint8_t> encoded;
+        ColumnarCodec::encodeTimestamps(periodic, encoded);
+        CHECK(encoded.size() < 1020);
+
+        encoded.clear();
+        ColumnarCodec::encodeValues(vector<double>(1000, 42.0), encoded);
+        CHECK(encoded.size() < 140);
+    }
+
+    void testColumnarExport() {
+
+        string path = "/tmp/SensorDataTests-" + to_string(getpid()) + ".sdcf";
+
+        ColumnarExporter exporter;
+        exporter.flushInterval = 10000; // Only full row groups and stop() write blocks
+        {
+            QuietOutput quiet;
+            CHECK(exporter.setBlockRows(64));
+            CHECK(!exporter.setBlockRows(1));
+        }
+        CHECK(exporter.start(path));
+
+        // 100 batches of 5 samples, 1 ms apart and generated 200 us apart before the batch arrived, the single
+        // filtered value belongs to the last sample
+        const int64_t start = 1700000000000000000LL;
+        vector<double> statistics(STATISTICS_FIELD_COUNT);
+        for (int batch = 0; batch < 100; batch++) {
+
+            vector<int> raw = { batch, batch + 1, batch + 2, batch + 3, batch + 4 };
+            vector<int64_t> generated(5);
+            for (int i = 0; i < 5; i++) generated[i] = start + batch * 1000000LL - (4 - i) * 200000LL;
+
+            iota(statistics.begin(), statistics.end(), batch * 100.0);
+            exporter.append(start + batch * 1000000LL, generated, raw, vector<double>{ batch + 2.0 }, statistics);
+        }
+
+        exporter.stop();
+        CHECK(exporter.getRowsExported() == 600 && exporter.getRowsDropped() == 0);
+
+        ColumnarFileReader reader;
+        if (!CHECK(reader.open(path))) {
+
+            unlink(path.c_str());
+            return;
+        }
+        CHECK(!reader.isRecovered());
+
+        // A row group is sealed once it has at least 64 rows, so the samples come in groups of 65. Row groups
+        // are numbered across both tables in write order, the first row of each follows from the row counts.
+        map<uint32_t, size_t> firstRow;
+        size_t sampleRows = 0, rollupRows = 0;
+        for (const ColumnarBlockEntry& entry : reader.getIndex()) {
+
+            CHECK(entry.rowCount <= 65 && entry.firstTimestampNs <= entry.lastTimestampNs);
+            if (entry.column != 0) continue;
+
+            size_t& rows = entry.table == COLUMNAR_TABLE_SAMPLES ? sampleRows : rollupRows;
+            firstRow[entry.rowGroup] = rows;
+            rows += entry.rowCount;
+        }
+        CHECK(sampleRows == 500 && rollupRows == 100);
+        CHECK(reader.getIndex().size() == 8 * SAMPLE_COLUMN_COUNT + 2 * ROLLUP_COLUMN_COUNT);
+
+        // Read back every samples row group and check the values, the filtered column and the zone maps
+        for (const ColumnarBlockEntry& entry : reader.getIndex()) {
+
+            if (entry.table != COLUMNAR_TABLE_SAMPLES || entry.column == 0) continue;
+
+            vector<double> values;
+            if (!CHECK(reader.readValues(entry, values))) continue;
+
+            double minimum = 1e300, maximum = -1e300;
+            for (size_t row = 0; row < values.size(); row++) {
+
+                size_t sample = firstRow[entry.rowGroup] + row;
+                double expected = entry.column == 1 ? static_cast<double>(sample / 5 + sample % 5) : (sample % 5 == 4 ? sample / 5 + 2.0 : NAN);
+                CHECK(entry.column == 2 && sample % 5 != 4 ? isnan(values[row]) : values[row] == expected);
+
+                if (!isnan(expected)) {
+
+                    minimum = min(minimum, expected);
+                    maximum = max(maximum, expected);
+                }
+            }
+
+            CHECK(entry.min == minimum && entry.max == maximum);
+        }
+
+        // Zone maps of the rollups cover the batch times, samples keep their own generation times
+        for (const ColumnarBlockEntry& entry : reader.getIndex()) {
+
+            if (entry.column != 0) continue;
+
+            vector<int64_t> timestamps;
+            CHECK(reader.readTimestamps(entry, timestamps));
+            CHECK(timestamps.front() == entry.firstTimestampNs && timestamps.back() == entry.lastTimestampNs);
+
+            for (size_t row = 0; row < timestamps.size(); row++) {
+
+                size_t index = firstRow[entry.rowGroup] + row;
+                int64_t expected = entry.table == COLUMNAR_TABLE_ROLLUPS ? start + static_cast<int64_t>(index) * 1000000LL
+                    : start + static_cast<int64_t>(index / 5) * 1000000LL - static_cast<int64_t>(4 - index % 5) * 200000LL;
+                CHECK(timestamps[row] == expected);
+            }
+        }
+
+        // A cut off header is not an export file
+        ofstream(path, ios::binary | ios::trunc) << "SDCF";
+        CHECK(!reader.open(path));
+        unlink(path.c_str());
+    }
+
+    // A file cut off in the last row group, as after a crash, keeps every complete row group readable
+    void testColumnarRecovery() {
+
+        string path = "/tmp/SensorDataTests-" + to_string(getpid()) + "-recovery.sdcf";
+
+        ColumnarExporter exporter;
+        exporter.flushInterval = 10000;
+        {
+            QuietOutput quiet;
+            exporter.setBlockRows(64);
+        }
+        CHECK(exporter.start(path));
+
+        vector<double> statistics(STATISTICS_FIELD_COUNT, 1.0);
+        for (int batch = 0; batch < 100; batch++) {
+
+            exporter.append(1700000000000000000LL + batch * 1000000LL, {}, vector<double>(5, batch), vector<double>{ batch + 0.5 }, statistics);
+        }
+        exporter.stop();
+
+        ColumnarFileReader reader;
+        if (!CHECK(reader.open(path))) {
+
+            unlink(path.c_str());
+            return;
+        }
+
+        vector<ColumnarBlockEntry> complete = reader.getIndex();
+        const ColumnarBlockEntry& last = complete.back();
+        uint64_t cut = last.offset + last.size / 2;
+        uint32_t lastGroup = last.rowGroup;
+
+        // Keep the file up to the middle of the last block
+        vector<char> bytes;
+        {
+            ifstream input(path, ios::binary);
+            bytes.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+        }
+        ofstream(path, ios::binary | ios::trunc).write(bytes.data(), cut);
+
+        bool opened = CHECK(reader.open(path)) && CHECK(reader.isRecovered());
+        if (opened) {
+
+            size_t expected = 0;
+            for (const ColumnarBlockEntry& entry : complete) expected += entry.rowGroup != lastGroup;
+
+            const vector<ColumnarBlockEntry>& recovered = reader.getIndex();
+            CHECK(recovered.size() == expected);
+            for (size_t i = 0; i < recovered.size() && i < expected; i++) {
+
+                CHECK(memcmp(&recovered[i], &complete[i], sizeof(ColumnarBlockEntry)) == 0);
+            }
+
+            vector<double> values;
+            for (const ColumnarBlockEntry& entry : recovered) {
+
+                if (entry.column != 0) CHECK(reader.readValues(entry, values));
+            }
+        }
+
+        unlink(path.c_str());
+    }
+
+    void testSimulationClock() {
+
+        SimulationClock clock;
+        vector<int> order;
+
+        clock.schedule(30, [&] { order.push_back(3); });
+        clock.schedule(10, [&] { order.push_back(1); clock.schedule(5, [&] { order.push_back(2); }); });
+        clock.schedule(30, [&] { order.push_back(4); });
+        clock.schedule(100, [&] { order.push_back(5); });
+
+        clock.runUntil(50);
+        CHECK((order == vector<int>{ 1, 2, 3, 4 }));
+        CHECK(clock.now() == 50);
+        CHECK(clock.getProcessedEvents() == 4);
+
+        clock.runUntil(200);
+        CHECK(order.back() == 5);
+        CHECK(clock.now() == 200);
+    }
+
+    // Feed the controller polls at its own polling rate with the given samples per second
+    void runController(AdaptivePollingController& controller, uint64_t& generated, uint64_t& nowMs, double rate, int polls,
+        int maxPollingRate = 2000, int maxCollectSize = 1000) {
+
+        for (int i = 0; i < polls; i++) {
+
+            nowMs += controller.pollingRate;
+            generated += static_cast<uint64_t>(llround(rate * controller.pollingRate / 1000.0));
+            controller.update(generated, nowMs, maxPollingRate, maxCollectSize);
+        }
+    }
+
+    void testAdaptiveConvergence() {
+
+        AdaptivePollingController controller;
+        uint64_t generated = 0, nowMs = 0;
+
+        // The first poll only records the starting point
+        controller.update(generated, nowMs, 2000, 1000);
+        CHECK(controller.estimatedRate == 0.0);
+
+        runController(controller, generated, nowMs, 80.0, 1);
+        CHECK(controller.pollingRate == 100);
+        CHECK(fabs(controller.estimatedRate - 80.0) < 1e-9);
+        CHECK(controller.collectSize == 8);
+
+        // After a step the error of the moving average decays by 1 - smoothing per poll
+        runController(controller, generated, nowMs, 200.0, 1);
+        CHECK(fabs(controller.estimatedRate - (80.0 + 0.2 * 120.0)) < 1e-9);
+
+        runController(controller, generated, nowMs, 200.0, 29);
+        CHECK(fabs(controller.estimatedRate - 200.0) < 120.0 * pow(0.8, 30) + 1e-9);
+        CHECK(controller.collectSize == 20);
+        CHECK(fabs(controller.getExpectedLatency() - 200.0) < 1.0);
+    }
+
+    void testAdaptiveClamping() {
+
+        AdaptivePollingController controller;
+        uint64_t generated = 0, nowMs = 0;
+
+        // A latency target below the wakeup budget is limited by the budget
+        controller.targetLatency = 10;
+        controller.maxWakeupsPerSecond = 50;
+        controller.update(generated, nowMs, 2000, 1000);
+        runController(controller, generated, nowMs, 1000.0, 5);
+        CHECK(controller.budgetLimited);
+        CHECK(controller.pollingRate == 20);
+        CHECK(controller.getWakeupsPerSecond() <= 50.0);
+
+        // Both decisions stay inside the limits of the settings
+        controller.targetLatency = 4000;
+        runController(controller, generated, nowMs, 1000.0, 5, 1000, 100);
+        CHECK(!controller.budgetLimited);
+        CHECK(controller.pollingRate == 999);
+        CHECK(controller.collectSize == 99);
+        CHECK(controller.overflowSamples > 0);
+
+        // No samples at all still collect one
+        AdaptivePollingController idle;
+        generated = nowMs = 0;
+        idle.update(generated, nowMs, 2000, 1000);
+        runController(idle, generated, nowMs, 0.0, 5);
+        CHECK(idle.collectSize == 1);
+    }
+
+    void testAdaptiveHysteresis() {
+
+        AdaptivePollingController controller;
+        controller.smoothing = 1.0; // Follow every measurement
+        uint64_t generated = 0, nowMs = 0;
+
+        controller.update(generated, nowMs, 2000, 1000);
+        runController(controller, generated, nowMs, 50.0, 1);
+        CHECK(controller.collectSize == 5);
+
+        // A rate that alternates just below and above the boundary keeps the size
+        for (int i = 0; i < 10; i++) {
+
+            runController(controller, generated, nowMs, i % 2 == 0 ? 40.0 : 50.0, 1);
+            if (!CHECK(controller.collectSize == 5)) return;
+        }
+
+        // Growing is immediate, shrinking needs a clear drop
+        runController(controller, generated, nowMs, 60.0, 1);
+        CHECK(controller.collectSize == 6);
+        runController(controller, generated, nowMs, 50.0, 1);
+        CHECK(controller.collectSize == 6);
+        runController(controller, generated, nowMs, 30.0, 1);
+        CHECK(controller.collectSize == 3);
+    }
+
+    // parseArguments on a list of arguments, its error messages on stderr are discarded
+    bool parseTestArguments(vector<string> arguments, RunOptions& options) {
+
+        vector<char*> argv = { const_cast<char*>("SensorDataSimulationAndProcessing") };
+        for (string& argument : arguments) argv.push_back(argument.data());
+
+        ostringstream sink;
+        streambuf* previous = cerr.rdbuf(sink.rdbuf());
+        bool parsed = parseArguments(static_cast<int>(argv.size()), argv.data(), options);
+        cerr.rdbuf(previous);
+        return parsed;
+    }
+
+    void testHeadlessArguments() {
+
+        string configPath = "SensorDataTests.conf";
+        {
+            ofstream config(configPath);
+            config << "# Comment line\nperiod 50   # Trailing comment\n\n  \nfiltertype 0\n";
+        }
+
+        RunOptions options;
+        CHECK(parseTestArguments({ "--headless", "--virtual-time", "--duration", "2500", "--samples", "300", "--config", configPath,
+            "--set", "collectsize=7", "--summary", "out.json" }, options));
+        remove(configPath.c_str());
+
+        CHECK(options.headless && options.virtualTime);
+        CHECK(options.durationMs == 2500 && options.maxSamples == 300);
+        CHECK(options.summaryPath == "out.json");
+        CHECK((options.settings == vector<string>{ "period 50   ", "filtertype 0", "collectsize 7" }));
+
+        // Malformed numbers are usage errors instead of exceptions
+        for (const vector<string>& arguments : vector<vector<string>>{
+            { "--duration", "abc" }, { "--duration", "-5" }, { "--samples", "10x" }, { "--samples", "" },
+            { "--duration", "99999999999999999999999" }, { "--pipelines", "5000" }, { "--threads", "1e3" },
+            { "--duration" }, { "--unknown" }, { "--config", "/nonexistent/config" } }) {
+
+            RunOptions rejected;
+            if (!CHECK(!parseTestArguments(arguments, rejected))) cout << "    accepted " << arguments[0] << "\n";
+        }
+    }
+
+    void testVirtualSimulation() {
+
+        Sensor<int> sensor;
+        DataProcessor<int> processor;
+        {
+            QuietOutput quiet;
+            sensor.setPeriod(10);
+        }
+
+        // The batches overlap, only the samples that are new in a batch count as processed
+        SimulationSummary summary = runVirtualSimulation(sensor, processor, 5000);
+        CHECK(summary.generatedSamples > 400 && summary.processedSamples > 0);
+        CHECK(summary.processedSamples <= summary.generatedSamples);
+
+        // --samples stops once that many generated samples went through the processor
+        summary = runVirtualSimulation(sensor, processor, 60000, 300);
+        CHECK(summary.processedSamples >= 300 && summary.processedSamples <= summary.generatedSamples);
+        CHECK(summary.simulatedMs >= 3000 && summary.simulatedMs < 60000);
+
+        // Samples and anomaly events are stamped with simulated time, an hour passes within a fraction of real time
+        {
+            QuietOutput quiet;
+            sensor.setPeriod(1000);
+            processor.addAnomalyRule("above", 0.0);
+        }
+
+        int64_t startNs = wallClockNs();
+        runVirtualSimulation(sensor, processor, 3600000);
+        int64_t hourNs = 3600LL * 1000000000;
+        vector<int64_t> timestamps = sensor.getCollectedTimestamps();
+        const vector<AnomalyEvent>& events = processor.getAnomalyDetector().getLatestEvents();
+
+        CHECK(!timestamps.empty() && timestamps.back() > startNs + hourNs - 2000000000LL);
+        CHECK(!events.empty() && events.back().timestampNs >= static_cast<uint64_t>(timestamps.back()));
+        CHECK(currentTimestampNs() < startNs + hourNs / 2);
+    }
+
+    bool applyTestSetting(const string& setting, Sensor<int>& sensor, DataProcessor<int>& processor) {
+
+        QuietOutput quiet;
+        istringstream iss(setting);
+        string property;
+        iss >> property;
+        return applySetting(property, iss, sensor, processor);
+    }
+
+    void testApplySetting() {
+
+        Sensor<int> sensor;
+        DataProcessor<int> processor;
+
+        CHECK(applyTestSetting("period 50", sensor, processor) && sensor.period == 50);
+        CHECK(applyTestSetting("numberofdatapoints 40", sensor, processor) && processor.rawDataSize == 40);
+        CHECK(applyTestSetting("rule above 10.5", sensor, processor));
+        CHECK(applyTestSetting("synth sine 1 2", sensor, processor));
+        CHECK(applyTestSetting("collectsize 8", sensor, processor) && processorCollectSize == 8);
+
+        // Out of range, missing and non-numeric values fail and leave the setting unchanged
+        for (const char* setting : { "period -5", "period abc", "period", "timing 7", "filtersize 100", "databuffersize 0",
+            "pollingrate 0", "collectsize 100000", "adaptive 2", "spectrumsize 100", "rule rate -1", "rule above x",
+            "rule sideways 1", "synth triangle 1", "printdata 5", "exportblock 1", "unknownproperty 1" }) {
+
+            if (!CHECK(!applyTestSetting(setting, sensor, processor))) cout << "    accepted " << setting << "\n";
+        }
+
+        CHECK(sensor.period == 50);
+        CHECK(processorCollectSize == 8);
+        processorCollectSize = 5;
+    }
+
+    void testJsonNumber() {
+
+        CHECK(jsonNumber(1.5) == "1.5");
+        CHECK(jsonNumber(-0.25) == "-0.25");
+        CHECK(jsonNumber(numeric_limits<double>::quiet_NaN()) == "null");
+        CHECK(jsonNumber(numeric_limits<double>::infinity()) == "null");
+        CHECK(jsonNumber(-numeric_limits<double>::infinity()) == "null");
+    }
+
+    void testShmRing() {
+
+#ifdef _WIN32
+        return;
+#else
+        string name = "/SensorDataTests." + to_string(getpid());
+        ShmRing producer;
+        ShmRing consumer;
+
+        if (!CHECK(producer.create(name, 10, sizeof(int)))) return;
+        if (!CHECK(consumer.open(name, sizeof(int)))) return;
+
+        for (int i = 0; i < 10; i++) producer.push(i);
+
+        vector<int> values;
+        CHECK(consumer.read(values, 4) == 4);
+        CHECK(consumer.read(values, 100) == 6);
+        CHECK((values == vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+
+        // Capacity is rounded up to 16, a consumer lapped by the producer skips the overwritten samples and the
+        // oldest one, whose slot the producer writes next
+        for (int i = 10; i < 50; i++) producer.push(i);
+
+        values.clear();
+        CHECK(consumer.read(values, 100) == 15);
+        CHECK(consumer.getDroppedSamples() == 25);
+        CHECK(values.front() == 35 && values.back() == 49);
+
+        // A new producer under the same name leaves the ring the consumer still maps untouched
+        ShmRing replacement;
+        CHECK(replacement.create(name, 10, sizeof(int)));
+        replacement.push(100);
+        CHECK(consumer.available() == 0 && consumer.getWrittenCount() == 50);
+
+        ShmRing wrongType;
+        QuietOutput quiet;
+        CHECK(!wrongType.open(name, sizeof(double)));
+#endif
+    }
+
+    void testPublisherFraming() {
+
+        PublisherFrameHeader header{};
+        header.magic = PUBLISHER_FRAME_MAGIC;
+        header.version = PUBLISHER_FRAME_VERSION;
+        header.type = FRAME_STATISTICS;
+        header.sequence = 0x01020304;
+        header.count = 3;
+        header.timestampNs = 1700000000123456789ULL;
+
+        vector<char> frame;
+        PublisherFraming::encodeFrame(frame, header, vector<int>{ -7, 0, 1 << 20 });
+        if (!CHECK(frame.size() == sizeof(PublisherFrameHeader) + 3 * sizeof(double))) return;
+
+        // Little-endian regardless of the host: the magic reads "FPDS" and the sequence starts with its low byte
+        CHECK(string(frame.data(), 4) == "FPDS");
+        CHECK(frame[8] == 0x04 && frame[11] == 0x01);
+
+        PublisherFrameHeader decoded = PublisherFraming::decodeHeader(frame.data());
+        CHECK(decoded.magic == header.magic && decoded.version == header.version && decoded.type == header.type);
+        CHECK(decoded.sequence == header.sequence && decoded.count == header.count && decoded.timestampNs == header.timestampNs);
+
+        vector<double> values;
+        PublisherFraming::decodeValues(frame.data() + sizeof(PublisherFrameHeader), decoded.count, values);
+        CHECK((values == vector<double>{ -7.0, 0.0, 1048576.0 }));
+    }
+
+#ifndef _WIN32
+    // Read one frame from a subscriber socket, false on timeout or a closed connection
+    bool receiveFrame(int fd, PublisherFrameHeader& header, vector<double>& values) {
+
+        vector<char> bytes(sizeof(PublisherFrameHeader));
+        for (size_t received = 0; received < bytes.size();) {
+
+            ssize_t n = recv(fd, bytes.data() + received, bytes.size() - received, 0);
+            if (n <= 0) return false;
+            received += n;
+        }
+
+        header = PublisherFraming::decodeHeader(bytes.data());
+        bytes.resize(header.count * sizeof(double));
+        for (size_t received = 0; received < bytes.size();) {
+
+            ssize_t n = recv(fd, bytes.data() + received, bytes.size() - received, 0);
+            if (n <= 0) return false;
+            received += n;
+        }
+
+        PublisherFraming::decodeValues(bytes.data(), header.count, values);
+        return true;
+    }
+#endif
+
+    // Frames dropped at the full queue are counted and leave a gap in the sequence numbers
+    void testPublisherSequenceGap() {
+
+#ifdef _WIN32
+        return;
+#else
+        string path = "/tmp/SensorDataTests." + to_string(getpid()) + ".sock";
+        DataPublisher publisher;
+        publisher.batchInterval = 200;
+        publisher.maxQueuedBytes = sizeof(PublisherFrameHeader) + sizeof(double); // One single-value frame
+
+        if (!CHECK(publisher.start(path))) return;
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        timeval timeout{ 5, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        if (!CHECK(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)) {
+
+            close(fd);
+            return;
+        }
+
+        for (int i = 0; i < 3; i++) publisher.publish(FRAME_RAW, vector<double>{ static_cast<double>(i) });
+
+        PublisherFrameHeader header;
+        vector<double> values;
+        CHECK(receiveFrame(fd, header, values) && header.sequence == 0 && values == vector<double>{ 0.0 });
+
+        publisher.publish(FRAME_RAW, vector<double>{ 3.0 });
+        CHECK(receiveFrame(fd, header, values) && header.sequence == 3 && values == vector<double>{ 3.0 });
+
+        CHECK(publisher.getFramesPublished() == 2);
+        CHECK(publisher.getFramesDropped() == 2);
+
+        close(fd);
+        publisher.stop();
+
+        // A restarted publisher starts with the frames of the new session and keeps numbering them
+        if (!CHECK(publisher.start(path))) return;
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (CHECK(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)) {
+
+            publisher.publish(FRAME_RAW, vector<double>{ 4.0 });
+            CHECK(receiveFrame(fd, header, values) && header.sequence == 4 && values == vector<double>{ 4.0 });
+        }
+
+        close(fd);
+        publisher.stop();
+#endif
+    }
+
+    PipelineTask produce(Channel<int>& channel, int count) {
+
+        for (int i = 1; i <= count; i++) {
+
+            bool sent = co_await channel.send(i);
+            if (!sent) break;
+        }
+
+        channel.close();
+    }
+
+    PipelineTask consume(Channel<int>& channel, long long& sum, int& received) {
+
+        while (true) {
+
+            optional<int> value = co_await channel.receive();
+            if (!value) break;
+
+            sum += *value;
+            received++;
+        }
+    }
+
+    void testChannelBackpressure() {
+
+        PipelineExecutor executor;
+        executor.start(2);
+
+        Channel<int> channel(executor, 4);
+        long long sum = 0;
+        int received = 0;
+
+        executor.spawn(consume(channel, sum, received));
+        executor.spawn(produce(channel, 10000));
+        executor.waitIdle();
+        executor.stop();
+
+        CHECK(received == 10000);
+        CHECK(sum == 10000LL * 10001 / 2);
+    }
+
+    // Cancelling wakes the sleeping generate stage at once, and the incomplete batch still reaches the processor
+    void testPipelineCancelDrains() {
+
+        PipelineExecutor executor;
+        executor.start(2);
+
+        Sensor<int> sensor;
+        DataProcessor<int> processor;
+        {
+            QuietOutput quiet;
+            sensor.setPeriod(10000);
+        }
+
+        SensorPipeline<int> pipeline(executor, sensor, processor);
+        pipeline.collectSize = 100;
+        uint64_t forwarded = 0;
+        pipeline.onProcessed = [&forwarded](const vector<int>& data, const vector<int64_t>&) { forwarded += data.size(); };
+        pipeline.start();
+
+        while (sensor.getGeneratedCount() == 0) this_thread::sleep_for(chrono::milliseconds(1));
+
+        auto cancelTime = chrono::steady_clock::now();
+        pipeline.cancel();
+        pipeline.waitFinished();
+        executor.stop();
+
+        CHECK(chrono::steady_clock::now() - cancelTime < chrono::seconds(2));
+        CHECK(pipeline.processedSamples == sensor.getGeneratedCount());
+        CHECK(forwarded == sensor.getGeneratedCount());
+        CHECK(pipeline.processedBatches == 1);
+    }
+
+    PipelineTask recordCpu(int& cpu) {
+
+        cpu = ThreadPlacement::getCurrentCpu();
+        co_return;
+    }
+
+    // Only CPUs of the process affinity are accepted, and a placed thread runs on its CPU
+    void testThreadPlacement() {
+
+#ifdef __linux__
+        ThreadPlacement placement;
+        int allowed = ThreadPlacement::getCurrentCpu();
+        {
+            QuietOutput quiet;
+            CHECK(!placement.setCpu(CPU_SETSIZE));
+            CHECK(!placement.setCpu(-2));
+            CHECK(placement.setCpu(-1));
+            CHECK(placement.setCpu(allowed));
+        }
+
+        CHECK(ThreadPlacement::isCpuAllowed(allowed));
+        CHECK(!ThreadPlacement::describeAllowedCpus().empty());
+
+        int running = -1;
+        thread placed([&] {
+
+            placement.apply();
+            running = ThreadPlacement::getCurrentCpu();
+        });
+        placed.join();
+
+        CHECK(running == allowed);
+        CHECK(!placement.isPinningFailed());
+        CHECK(placement.describe().find("failed") == string::npos);
+
+        // Executor workers follow the placement before they resume a coroutine
+        PipelineExecutor executor;
+        executor.start(2, &placement);
+
+        Channel<int> channel(executor, 4);
+        long long sum = 0;
+        int received = 0;
+        executor.spawn(consume(channel, sum, received));
+        executor.spawn(produce(channel, 100));
+        executor.waitIdle();
+
+        int workerCpu = -1;
+        executor.spawn(recordCpu(workerCpu));
+        executor.waitIdle();
+        executor.stop();
+
+        CHECK(received == 100);
+        CHECK(workerCpu == allowed);
+#endif
+
+        // Localized buffers keep their contents and get the spare capacity
+        vector<double> buffer = { 1.0, 2.0, 3.0 };
+        localizeVector(buffer, 1);
+        CHECK(buffer == vector<double>({ 1.0, 2.0, 3.0 }));
+        CHECK(buffer.capacity() >= 4);
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    vector<pair<const char*, function<void()>>> tests = {
+        { "RawWindowInt", testRawWindowInt },
+        { "RawWindowDouble", testRawWindowDouble },
+        { "NoFilterWindow", testNoFilterWindow },
+        { "EmptyBatchKeepsWindow", testEmptyBatchKeepsWindow },
+        { "SingleSampleShiftsWindow", testSingleSampleShiftsWindow },
+        { "MovingAverageStage", testMovingAverageStage },
+        { "SubsetAverages", testSubsetAverages },
+        { "SensorCollectData", testSensorCollectData },
+        { "SensorNewDataCount", testSensorNewDataCount },
+        { "SensorSignal", testSensorSignal },
+        { "SensorSeedReproducible", testSensorSeedReproducible },
+        { "SensorDelayRejection", testSensorDelayRejection },
+        { "SignalSynthesizer", testSignalSynthesizer },
+        { "SensorLifecycle", testSensorLifecycle },
+        { "SketchAccuracy", testSketchAccuracy },
+        { "SketchMerge", testSketchMerge },
+        { "SketchOverlappingBatches", testSketchOverlappingBatches },
+        { "AnomalyDetector", testAnomalyDetector },
+        { "AnomalyPrecision", testAnomalyPrecision },
+        { "AnomalyEventRules", testAnomalyEventRules },
+        { "ProcessorReconfiguration", testProcessorReconfiguration },
+        { "RealTransform", testRealTransform },
+        { "SpectralStatistics", testSpectralStatistics },
+        { "SpectrumOverlappingBatches", testSpectrumOverlappingBatches },
+        { "ColumnarCodec", testColumnarCodec },
+        { "ColumnarExport", testColumnarExport },
+        { "ColumnarRecovery", testColumnarRecovery },
+        { "SimulationClock", testSimulationClock },
+        { "AdaptiveConvergence", testAdaptiveConvergence },
+        { "AdaptiveClamping", testAdaptiveClamping },
+        { "AdaptiveHysteresis", testAdaptiveHysteresis },
+        { "HeadlessArguments", testHeadlessArguments },
+        { "VirtualSimulation", testVirtualSimulation },
+        { "ApplySetting", testApplySetting },
+        { "JsonNumber", testJsonNumber },
+        { "ShmRing", testShmRing },
+        { "PublisherFraming", testPublisherFraming },
+        { "PublisherSequenceGap", testPublisherSequenceGap },
+        { "ChannelBackpressure", testChannelBackpressure },
+        { "PipelineCancelDrains", testPipelineCancelDrains },
+        { "ThreadPlacement", testThreadPlacement },
+    };
+
+    string filter;
+    for (int i = 1; i < argc; i++) {
+
+        string argument = argv[i];
+        if (argument == "--seed" && i + 1 < argc) baseSeed = static_cast<uint32_t>(stoul(argv[++i]));
+        else if (argument == "--trials" && i + 1 < argc) trials = max(stoi(argv[++i]), 1);
+        else filter = argument;
+    }
+
+    cout << "Seed " << baseSeed << ", " << trials << " trials per property\n";
+
+    int failedTests = 0;
+    int ranTests = 0;
+
+    for (auto& [name, run] : tests) {
+
+        if (!filter.empty() && string(name).find(filter) == string::npos) continue;
+
+        int failedBefore = failedChecks;
+        run();
+        ranTests++;
+
+        bool passed = failedChecks == failedBefore;
+        if (!passed) failedTests++;
+        cout << (passed ? "[ PASS ] " : "[ FAIL ] ") << name << "\n";
+    }
+
+    cout << ranTests - failedTests << "/" << ranTests << " tests passed\n";
+    return failedTests == 0 ? 0 : 1;
+}
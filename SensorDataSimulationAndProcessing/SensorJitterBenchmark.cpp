@@ -0,0 +1,214 @@
+// SensorJitterBenchmark.cpp: Measures the wake-up latency of the generation and processing threads under the
+// same CPU pinning and SCHED_FIFO settings as the application (sensorcpu, processorcpu, rtpriority).
+//   wakeup  - a periodic generation thread sleeps until its next deadline, latency is how late it woke up
+//   handoff - the generation thread signals the processing thread for every sample, latency is the time from
+//             the signal until the processing thread runs, which grows when the two threads sit on different sockets
+// Usage: SensorJitterBenchmark [--sensor-cpu N] [--processor-cpu N] [--rtpriority N] [--period-us N] [--samples N] [--csv]
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+
+#include "ThreadPlacement.cpp"
+
+using namespace std;
+
+namespace {
+
+    struct Options {
+
+        int sensorCpu = -1;
+        int processorCpu = -1;
+        int rtPriority = 0;
+        int periodUs = 1000;
+        int samples = 5000;
+        bool csv = false;
+    };
+
+    int64_t nowNs() {
+
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    vector<int64_t> measureWakeup(ThreadPlacement& placement, const Options& options) {
+
+        vector<int64_t> latencies;
+        latencies.reserve(options.samples);
+
+        thread generation([&] {
+
+            placement.apply();
+
+            auto deadline = chrono::steady_clock::now();
+            for (int i = 0; i < options.samples; i++) {
+
+                deadline += chrono::microseconds(options.periodUs);
+                this_thread::sleep_until(deadline);
+                latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - deadline).count());
+            }
+        });
+
+        generation.join();
+        return latencies;
+    }
+
+    vector<int64_t> measureHandoff(ThreadPlacement& sensorPlacement, ThreadPlacement& processorPlacement, const Options& options) {
+
+        vector<int64_t> latencies;
+        latencies.reserve(options.samples);
+
+        mutex handoffMutex;
+        condition_variable handoffCondition;
+        int64_t signalledAt = 0;
+        int sequence = 0;
+        bool finished = false;
+
+        thread processing([&] {
+
+            processorPlacement.apply();
+
+            unique_lock<mutex> lock(handoffMutex);
+            int seen = 0;
+
+            while (true) {
+
+                handoffCondition.wait(lock, [&] { return sequence != seen || finished; });
+                if (sequence == seen) break;
+
+                latencies.push_back(nowNs() - signalledAt);
+                seen = sequence;
+            }
+        });
+
+        thread generation([&] {
+
+            sensorPlacement.apply();
+
+            auto deadline = chrono::steady_clock::now();
+            for (int i = 0; i < options.samples; i++) {
+
+                deadline += chrono::microseconds(options.periodUs);
+                this_thread::sleep_until(deadline);
+
+                {
+                    lock_guard<mutex> lock(handoffMutex);
+                    signalledAt = nowNs();
+                    sequence++;
+                }
+                handoffCondition.notify_one();
+            }
+
+            {
+                lock_guard<mutex> lock(handoffMutex);
+                finished = true;
+            }
+            handoffCondition.notify_one();
+        });
+
+        generation.join();
+        processing.join();
+        return latencies;
+    }
+
+    void report(const string& name, vector<int64_t> latencies, const Options& options) {
+
+        if (latencies.empty()) return;
+
+        sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double q) { return latencies[static_cast<size_t>(q * (latencies.size() - 1))] / 1000.0; };
+
+        if (options.csv) {
+
+            cout << name << "," << latencies.size() << "," << fixed << setprecision(1) << latencies.front() / 1000.0 << "," << percentile(0.50) << ","
+                << percentile(0.90) << "," << percentile(0.99) << "," << percentile(0.999) << "," << latencies.back() / 1000.0 << "\n";
+            return;
+        }
+
+        cout << name << " latency (us), " << latencies.size() << " samples\n";
+        cout << fixed << setprecision(1);
+        cout << "  min " << latencies.front() / 1000.0 << "  p50 " << percentile(0.50) << "  p90 " << percentile(0.90)
+            << "  p99 " << percentile(0.99) << "  p99.9 " << percentile(0.999) << "  max " << latencies.back() / 1000.0 << "\n";
+
+        // Power of two histogram in microseconds
+        vector<size_t> buckets;
+        for (int64_t latency : latencies) {
+
+            size_t bucket = 0;
+            for (int64_t us = latency / 1000; us > 0; us >>= 1) bucket++;
+            if (bucket >= buckets.size()) buckets.resize(bucket + 1, 0);
+            buckets[bucket]++;
+        }
+
+        size_t largest = *max_element(buckets.begin(), buckets.end());
+        for (size_t i = 0; i < buckets.size(); i++) {
+
+            if (buckets[i] == 0) continue;
+
+            string range = i == 0 ? "< 1" : to_string(1LL << (i - 1)) + "-" + to_string((1LL << i) - 1);
+            cout << "  " << setw(12) << range << " us " << setw(8) << buckets[i] << " " << string(buckets[i] * 50 / largest, '#') << "\n";
+        }
+
+        cout << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--sensor-cpu" && hasValue) options.sensorCpu = stoi(argv[++i]);
+        else if (argument == "--processor-cpu" && hasValue) options.processorCpu = stoi(argv[++i]);
+        else if (argument == "--rtpriority" && hasValue) options.rtPriority = stoi(argv[++i]);
+        else if (argument == "--period-us" && hasValue) options.periodUs = max(stoi(argv[++i]), 1);
+        else if (argument == "--samples" && hasValue) options.samples = max(stoi(argv[++i]), 1);
+        else if (argument == "--csv") options.csv = true;
+        else {
+
+            cerr << "Unknown option: " << argument << "\n";
+            return 2;
+        }
+    }
+
+    ThreadPlacement sensorPlacement;
+    ThreadPlacement processorPlacement;
+
+    // The setters report to cout like the set command, collect the messages and only show failures
+    ostringstream messages;
+    streambuf* stdoutBuffer = cout.rdbuf(messages.rdbuf());
+    bool valid = (options.sensorCpu < 0 || sensorPlacement.setCpu(options.sensorCpu)) && (options.processorCpu < 0 || processorPlacement.setCpu(options.processorCpu))
+        && (options.rtPriority == 0 || (sensorPlacement.setRealtimePriority(options.rtPriority) && processorPlacement.setRealtimePriority(options.rtPriority)));
+    cout.rdbuf(stdoutBuffer);
+
+    if (!valid) {
+
+        cerr << messages.str() << "\n";
+        return 2;
+    }
+
+    vector<int64_t> wakeup = measureWakeup(sensorPlacement, options);
+    vector<int64_t> handoff = measureHandoff(sensorPlacement, processorPlacement, options);
+
+    if (options.csv) {
+
+        cout << "test,samples,min_us,p50_us,p90_us,p99_us,p999_us,max_us\n";
+    }
+    else {
+
+        cout << "Sensor CPU: " << sensorPlacement.describe() << (sensorPlacement.isRealtimeActive() ? " (active)" : "") << "\n";
+        cout << "Processor CPU: " << processorPlacement.describe() << (processorPlacement.isRealtimeActive() ? " (active)" : "") << "\n";
+        cout << "Period: " << options.periodUs << " us\n\n";
+    }
+
+    report("wakeup", wakeup, options);
+    report("handoff", handoff, options);
+    return 0;
+}
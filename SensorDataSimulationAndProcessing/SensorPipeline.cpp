@@ -0,0 +1,233 @@
+#pragma once
+
+#include <functional>
+
+#include "Sensor.cpp"
+#include "DataProcessor.cpp"
+#include "PipelineExecutor.cpp"
+
+using namespace std;
+
+// Statistics of one processed batch, produced by the statistics stage
+struct PipelineStatistics {
+
+    size_t batchSize = 0;
+    double rawMin = 0.0, rawMax = 0.0, rawAverage = 0.0;
+    double filteredMin = 0.0, filteredMax = 0.0, filteredAverage = 0.0;
+    double rawP50 = 0.0, rawP95 = 0.0, rawP99 = 0.0;
+};
+
+// One logical Sensor -> DataProcessor pipeline as five coroutine stages connected by bounded channels:
+// generate -> ingest (batching) -> filter -> statistics -> output. Cancelling closes the sample channel,
+// the downstream stages drain what is left and finish in order.
+template<typename dataType>
+class SensorPipeline {
+
+    private:
+
+        struct TimedSample {
+
+            dataType value;
+            int64_t timestampNs;    // Generation time in ns since the epoch
+        };
+
+        struct Batch {
+
+            vector<dataType> values;
+            vector<int64_t> timestamps;
+        };
+
+        struct ProcessedBatch {
+
+            size_t batchSize = 0;
+            vector<dataType> rawWindow;
+            vector<double> filteredWindow;
+            double p50 = 0.0, p95 = 0.0, p99 = 0.0;
+        };
+
+        PipelineExecutor& executor;
+        Sensor<dataType>& sensor;
+        DataProcessor<dataType>& processor;
+        CancellationToken token;
+        unsigned int localizedVersion = UINT_MAX; // Placement version the processor's buffers were allocated under
+
+        Channel<TimedSample> samples;
+        Channel<Batch> batches;
+        Channel<ProcessedBatch> processed;
+        Channel<PipelineStatistics> statistics;
+
+        PipelineTask generateStage() {
+
+            while (!this->token.isCancelled()) {
+
+                dataType value = this->sensor.nextDataPoint();
+                bool sent = co_await this->samples.send(TimedSample{ value, currentTimestampNs() });
+                if (!sent) break;
+                co_await this->executor.sleepFor(this->sensor.nextDelay(), this->token);
+            }
+
+            this->samples.close();
+            stageFinished();
+        }
+
+        PipelineTask ingestStage() {
+
+            Batch batch;
+
+            while (true) {
+
+                optional<TimedSample> sample = co_await this->samples.receive();
+                if (!sample) break;
+
+                batch.values.push_back(sample->value);
+                batch.timestamps.push_back(sample->timestampNs);
+
+                if (batch.values.size() >= static_cast<size_t>(max(this->collectSize, 1))) {
+
+                    bool sent = co_await this->batches.send(move(batch));
+                    if (!sent) break;
+                    batch = Batch();
+                }
+            }
+
+            // The samples of an incomplete batch are still processed when the pipeline is cancelled
+            if (!batch.values.empty()) {
+
+                co_await this->batches.send(move(batch));
+            }
+
+            this->batches.close();
+            stageFinished();
+        }
+
+        PipelineTask filterStage() {
+
+            while (true) {
+
+                optional<Batch> batch = co_await this->batches.receive();
+                if (!batch) break;
+
+                ProcessedBatch result;
+                {
+                    lock_guard<mutex> lock(this->processorMutex);
+
+                    // The worker already follows a changed placement, the processor's buffers move to its node
+                    ThreadPlacement* placement = this->executor.getPlacement();
+                    if (placement && placement->getVersion() != this->localizedVersion) {
+
+                        this->localizedVersion = placement->getVersion();
+                        this->processor.localizeBuffers();
+                    }
+
+                    this->processor.inputData(batch->values);
+                    if (this->onProcessed) this->onProcessed(batch->values, batch->timestamps);
+
+                    result.batchSize = batch->values.size();
+                    result.rawWindow = this->processor.getRawData();
+                    result.filteredWindow = this->processor.getFilteredData();
+                    result.p50 = this->processor.getRawPercentile(0.50);
+                    result.p95 = this->processor.getRawPercentile(0.95);
+                    result.p99 = this->processor.getRawPercentile(0.99);
+                }
+
+                bool sent = co_await this->processed.send(move(result));
+                if (!sent) break;
+            }
+
+            this->processed.close();
+            stageFinished();
+        }
+
+        PipelineTask statisticsStage() {
+
+            while (true) {
+
+                optional<ProcessedBatch> batch = co_await this->processed.receive();
+                if (!batch) break;
+
+                PipelineStatistics result;
+                result.batchSize = batch->batchSize;
+                result.rawMin = this->processor.getMinValue(batch->rawWindow);
+                result.rawMax = this->processor.getMaxValue(batch->rawWindow);
+                result.rawAverage = this->processor.calculateAverage(batch->rawWindow);
+                result.filteredMin = this->processor.getMinValue(batch->filteredWindow);
+                result.filteredMax = this->processor.getMaxValue(batch->filteredWindow);
+                result.filteredAverage = this->processor.calculateAverage(batch->filteredWindow);
+                result.rawP50 = batch->p50;
+                result.rawP95 = batch->p95;
+                result.rawP99 = batch->p99;
+
+                bool sent = co_await this->statistics.send(result);
+                if (!sent) break;
+            }
+
+            this->statistics.close();
+            stageFinished();
+        }
+
+        PipelineTask outputStage() {
+
+            while (true) {
+
+                optional<PipelineStatistics> result = co_await this->statistics.receive();
+                if (!result) break;
+
+                this->processedSamples += result->batchSize;
+                this->processedBatches++;
+                this->latest = *result;
+
+                if (this->onOutput) this->onOutput(*result);
+            }
+
+            stageFinished();
+        }
+
+        mutex finishedMutex;
+        condition_variable finishedCondition;
+        int activeStages = 0;
+
+        // Last statement of every stage. Notifying under the lock keeps the pipeline alive until the waiter wakes.
+        void stageFinished() {
+
+            lock_guard<mutex> lock(this->finishedMutex);
+            if (--this->activeStages == 0) this->finishedCondition.notify_all();
+        }
+
+    public:
+
+        int collectSize = 5;
+        mutex processorMutex;                                   // Held while the processor is updated or read
+        function<void(const vector<dataType>&, const vector<int64_t>&)> onProcessed;    // Called in the filter stage with processorMutex held, with the generation times
+        function<void(const PipelineStatistics&)> onOutput;     // Called in the output stage
+
+        atomic<uint64_t> processedSamples{ 0 };
+        atomic<uint64_t> processedBatches{ 0 };
+        PipelineStatistics latest;
+
+        SensorPipeline(PipelineExecutor& executor, Sensor<dataType>& sensor, DataProcessor<dataType>& processor, size_t channelCapacity = 64)
+            : executor(executor), sensor(sensor), processor(processor),
+            samples(executor, channelCapacity), batches(executor, channelCapacity), processed(executor, channelCapacity), statistics(executor, channelCapacity) {}
+
+        void start() {
+
+            this->activeStages = 5;
+            this->executor.spawn(outputStage());
+            this->executor.spawn(statisticsStage());
+            this->executor.spawn(filterStage());
+            this->executor.spawn(ingestStage());
+            this->executor.spawn(generateStage());
+        }
+
+        void cancel() {
+
+            this->token.cancel();
+            this->executor.wakeCancelled(this->token);
+        }
+
+        // Wait until every stage has drained and returned, the pipeline can be destroyed afterwards
+        void waitFinished() {
+
+            unique_lock<mutex> lock(this->finishedMutex);
+            this->finishedCondition.wait(lock, [this] { return this->activeStages == 0; });
+        }
+};
@@ -0,0 +1,168 @@
+// SensorSubscriber.cpp: Connects to the data publisher socket and prints the received frames.
+// Usage: SensorSubscriber [socket path] [--summary]
+
+#include "DataPublisher.cpp"
+
+using namespace std;
+
+#ifdef _WIN32
+
+int main() {
+
+    cout << "SensorSubscriber is only supported on POSIX systems.\n";
+    return 1;
+}
+
+#else
+
+// Read exactly size bytes, returns false when the publisher closed the connection
+bool readExact(int fd, char* buffer, size_t size) {
+
+    size_t received = 0;
+    while (received < size) {
+
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n <= 0) return false;
+        received += n;
+    }
+
+    return true;
+}
+
+const char* frameTypeName(uint16_t type) {
+
+    switch (type) {
+
+    case FRAME_RAW:
+
+        return "RAW";
+
+    case FRAME_FILTERED:
+
+        return "FILTERED";
+
+    case FRAME_STATISTICS:
+
+        return "STATISTICS";
+
+    case FRAME_ANOMALY:
+
+        return "ANOMALY";
+
+    default:
+
+        return "UNKNOWN";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    string path = "/tmp/SensorDataSimulationAndProcessing.sock";
+    bool summaryOnly = false;
+
+    for (int i = 1; i < argc; i++) {
+
+        string argument = argv[i];
+        if (argument == "--summary") {
+
+            summaryOnly = true;
+        }
+        else {
+
+            path = argument;
+        }
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+
+        cout << "Could not connect to " << path << "\n";
+        return 1;
+    }
+
+    cout << "Connected to " << path << "\n";
+
+    PublisherFrameHeader header;
+    vector<char> frameBytes;
+    vector<double> payload;
+    uint64_t frames = 0;
+    uint64_t samples = 0;
+    uint64_t lostFrames = 0;
+    uint32_t expectedSequence = 0;
+    auto lastReport = chrono::steady_clock::now();
+
+    while (true) {
+
+        frameBytes.resize(sizeof(PublisherFrameHeader));
+        if (!readExact(fd, frameBytes.data(), frameBytes.size())) break;
+
+        header = PublisherFraming::decodeHeader(frameBytes.data());
+        if (header.magic != PUBLISHER_FRAME_MAGIC || header.version != PUBLISHER_FRAME_VERSION) {
+
+            cout << "Invalid frame header, closing connection.\n";
+            break;
+        }
+
+        frameBytes.resize(header.count * sizeof(double));
+        if (!readExact(fd, frameBytes.data(), frameBytes.size())) break;
+        PublisherFraming::decodeValues(frameBytes.data(), header.count, payload);
+
+        // Sequence numbers are global, a gap means frames were dropped for this subscriber
+        if (frames > 0 && header.sequence != expectedSequence) {
+
+            lostFrames += header.sequence - expectedSequence;
+        }
+        expectedSequence = header.sequence + 1;
+        frames++;
+
+        if (header.type == FRAME_RAW || header.type == FRAME_FILTERED) {
+
+            samples += header.count;
+        }
+
+        if (summaryOnly) {
+
+            auto now = chrono::steady_clock::now();
+            if (now - lastReport >= chrono::seconds(1)) {
+
+                cout << "frames: " << frames << " samples: " << samples << " lost frames: " << lostFrames << "\n";
+                lastReport = now;
+            }
+            continue;
+        }
+
+        cout << "#" << header.sequence << " " << frameTypeName(header.type) << " t=" << header.timestampNs << ":";
+        if (header.type == FRAME_STATISTICS && header.count == STATISTICS_FIELD_COUNT) {
+
+            for (int i = 0; i < STATISTICS_FIELD_COUNT; i++) {
+
+                cout << " " << statisticsFieldNames[i] << "=" << payload[i];
+            }
+        }
+        else if (header.type == FRAME_ANOMALY && header.count % ANOMALY_FIELD_COUNT == 0) {
+
+            for (size_t i = 0; i < payload.size(); i++) {
+
+                cout << (i % ANOMALY_FIELD_COUNT == 0 ? " |" : "") << " " << anomalyFieldNames[i % ANOMALY_FIELD_COUNT] << "=" << payload[i];
+            }
+        }
+        else {
+
+            for (double value : payload) {
+
+                cout << " " << value;
+            }
+        }
+        cout << "\n";
+    }
+
+    cout << "Publisher closed the connection. frames: " << frames << " samples: " << samples << " lost frames: " << lostFrames << "\n";
+    close(fd);
+    return 0;
+}
+
+#endif
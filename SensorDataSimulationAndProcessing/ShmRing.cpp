@@ -0,0 +1,287 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#endif
+
+using namespace std;
+
+#define SHM_RING_MAGIC 0x53445252 // "SDRR"
+
+#define SHM_ROLE_NONE 0
+#define SHM_ROLE_SENSOR 1
+#define SHM_ROLE_PROCESSOR 2
+
+// Control block at the start of the shared mapping, the sample slots follow it. The producer and the
+// futex words live on separate cache lines so that consumers polling head do not slow down the writer.
+struct ShmRingHeader {
+
+    uint32_t magic;
+    uint32_t elementSize;
+    uint64_t capacity;                      // Number of slots, always a power of two
+    alignas(64) atomic<uint64_t> head;      // Total number of samples ever written
+    alignas(64) atomic<uint32_t> wakeSequence;
+    atomic<uint32_t> waiters;
+};
+
+static_assert(atomic<uint64_t>::is_always_lock_free && atomic<uint32_t>::is_always_lock_free, "Shared memory ring needs lock-free atomics");
+
+// Single producer ring buffer in POSIX shared memory. The producer never waits: it writes the slot and
+// publishes head, and only makes a syscall when a consumer is sleeping on the futex. Every consumer keeps its
+// own read cursor, so one sensor process can feed several processor processes. A consumer that falls more
+// than capacity samples behind skips the overwritten samples and counts them as dropped.
+class ShmRing {
+
+    private:
+
+        ShmRingHeader* header = nullptr;
+        char* slots = nullptr;
+        size_t mappingSize = 0;
+        string name;
+        bool owner = false;
+        uint64_t cursor = 0;
+        uint64_t droppedSamples = 0;
+
+        static void futexWait(atomic<uint32_t>* word, uint32_t expected, int timeoutMs) {
+
+#ifdef __linux__
+            timespec timeout{ timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+            // Without futexes idle consumers fall back to a short sleep
+            if (word->load() == expected) this_thread::sleep_for(chrono::milliseconds(min(timeoutMs, 1)));
+#endif
+        }
+
+        static void futexWakeAll(atomic<uint32_t>* word) {
+
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+        }
+
+        bool map(int fd, size_t size) {
+
+#ifdef _WIN32
+            return false;
+#else
+            void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED) return false;
+
+            this->mappingSize = size;
+            this->header = static_cast<ShmRingHeader*>(mapping);
+            this->slots = static_cast<char*>(mapping) + sizeof(ShmRingHeader);
+            return true;
+#endif
+        }
+
+    public:
+
+        ~ShmRing() {
+
+            close();
+        }
+
+        // Create the ring as its producer, capacity is rounded up to a power of two
+        bool create(const string& name, size_t capacity, size_t elementSize) {
+
+#ifdef _WIN32
+            cout << "Shared memory transport is only supported on POSIX systems.";
+            return false;
+#else
+            close();
+
+            // At least two slots, one of them may be in the middle of a write
+            size_t slotCount = 2;
+            while (slotCount < capacity) slotCount <<= 1;
+
+            // Truncating an existing ring would zero it under a consumer that still maps it. The old name is unlinked
+            // instead, such a consumer keeps its mapping and the new ring is a separate object.
+            shm_unlink(name.c_str());
+            int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_EXCL, 0600);
+            size_t size = sizeof(ShmRingHeader) + slotCount * elementSize;
+            if (fd < 0 || ftruncate(fd, size) < 0 || !map(fd, size)) {
+
+                cout << "Shared memory ring " << name << " could not be created.";
+                return false;
+            }
+
+            // Only the header is written here. The slots are first written by the generation thread after it was
+            // pinned, so their pages are placed on the node of the sensor CPU.
+            this->header->magic = SHM_RING_MAGIC;
+            this->header->elementSize = static_cast<uint32_t>(elementSize);
+            this->header->capacity = slotCount;
+            this->header->head.store(0);
+            this->header->wakeSequence.store(0);
+            this->header->waiters.store(0);
+            this->name = name;
+            this->owner = true;
+            return true;
+#endif
+        }
+
+        // Attach to an existing ring as a consumer, reading starts at the newest sample
+        bool open(const string& name, size_t elementSize) {
+
+#ifdef _WIN32
+            cout << "Shared memory transport is only supported on POSIX systems.";
+            return false;
+#else
+            close();
+
+            int fd = shm_open(name.c_str(), O_RDWR, 0600);
+            struct stat info {};
+            if (fd < 0 || fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ShmRingHeader) || !map(fd, info.st_size)) {
+
+                cout << "Shared memory ring " << name << " could not be opened.";
+                return false;
+            }
+
+            if (this->header->magic != SHM_RING_MAGIC || this->header->elementSize != elementSize) {
+
+                cout << "Shared memory ring " << name << " has a different sample type.";
+                close();
+                return false;
+            }
+
+            this->name = name;
+            this->owner = false;
+            this->cursor = this->header->head.load(memory_order_acquire);
+            return true;
+#endif
+        }
+
+        void close() {
+
+#ifndef _WIN32
+            if (this->header == nullptr) return;
+
+            munmap(this->header, this->mappingSize);
+            if (this->owner) shm_unlink(this->name.c_str());
+#endif
+            this->header = nullptr;
+            this->slots = nullptr;
+        }
+
+        template<typename T>
+        void push(const T& value) {
+
+            uint64_t index = this->header->head.load(memory_order_relaxed);
+            memcpy(this->slots + (index & (this->header->capacity - 1)) * sizeof(T), &value, sizeof(T));
+
+            // seq_cst store orders the head update before the waiters check below
+            this->header->head.store(index + 1, memory_order_seq_cst);
+
+            if (this->header->waiters.load(memory_order_seq_cst) > 0) {
+
+                this->header->wakeSequence.fetch_add(1);
+                futexWakeAll(&this->header->wakeSequence);
+            }
+        }
+
+        // Total number of samples the producer has written
+        uint64_t getWrittenCount() {
+
+            return this->header->head.load(memory_order_acquire);
+        }
+
+        uint64_t available() {
+
+            return this->header->head.load(memory_order_acquire) - this->cursor;
+        }
+
+        // Sleep until at least count unread samples are available or the timeout expires
+        void waitForData(uint64_t count, int timeoutMs) {
+
+            auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+            while (available() < count) {
+
+                int remainingMs = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count());
+                if (remainingMs <= 0) return;
+
+                this->header->waiters.fetch_add(1);
+                uint32_t sequence = this->header->wakeSequence.load();
+
+                if (available() < count) {
+
+                    futexWait(&this->header->wakeSequence, sequence, remainingMs);
+                }
+
+                this->header->waiters.fetch_sub(1);
+            }
+        }
+
+        // Append up to maxCount unread samples to out and return how many were read. The producer writes the slot
+        // of the sample at head before it publishes it, so only the capacity - 1 samples before head are stable.
+        template<typename T>
+        size_t read(vector<T>& out, size_t maxCount) {
+
+            uint64_t stable = this->header->capacity - 1;
+            uint64_t head = this->header->head.load(memory_order_acquire);
+
+            if (head - this->cursor > stable) {
+
+                this->droppedSamples += head - this->cursor - stable;
+                this->cursor = head - stable;
+            }
+
+            uint64_t start = this->cursor;
+            size_t count = static_cast<size_t>(min<uint64_t>(head - start, maxCount));
+            size_t first = out.size();
+            out.resize(first + count);
+
+            for (size_t i = 0; i < count; i++) {
+
+                memcpy(&out[first + i], this->slots + ((start + i) & (this->header->capacity - 1)) * sizeof(T), sizeof(T));
+            }
+
+            // Seqlock check: the fence keeps the copies above before the second load of head, and samples the
+            // producer overwrote or started to overwrite while they were copied are discarded
+            atomic_thread_fence(memory_order_acquire);
+            uint64_t headAfter = this->header->head.load(memory_order_relaxed);
+            size_t overwritten = headAfter - start > stable ? static_cast<size_t>(min<uint64_t>(headAfter - start - stable, count)) : 0;
+            if (overwritten > 0) {
+
+                out.erase(out.begin() + first, out.begin() + first + overwritten);
+                this->droppedSamples += overwritten;
+            }
+
+            this->cursor = start + count;
+            return count - overwritten;
+        }
+
+        bool isOpen() {
+
+            return this->header != nullptr;
+        }
+
+        string getName() {
+
+            return this->name;
+        }
+
+        uint64_t getDroppedSamples() {
+
+            return this->droppedSamples;
+        }
+};
@@ -0,0 +1,487 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+#define SIGNAL_SINE 0       // amplitude, frequency in Hz
+#define SIGNAL_SQUARE 1     // amplitude, frequency in Hz
+#define SIGNAL_CHIRP 2      // amplitude, start frequency, end frequency, sweep time in seconds
+#define SIGNAL_NOISE 3      // standard deviation of Gaussian noise
+#define SIGNAL_DRIFT 4      // units per second
+#define SIGNAL_OFFSET 5     // constant level
+#define SIGNAL_SPIKES 6     // probability per sample, amplitude
+#define SIGNAL_DROPOUTS 7   // probability per sample, length in samples, the signal reads 0 during a dropout
+#define SIGNAL_BURSTS 8     // samples per burst, only changes the arrival times
+#define SIGNAL_COMPONENT_TYPES 9
+
+inline const char* const signalComponentNames[SIGNAL_COMPONENT_TYPES] = { "sine", "square", "chirp", "noise", "drift", "offset", "spikes", "dropouts", "bursts" };
+inline const int signalComponentParameterCount[SIGNAL_COMPONENT_TYPES] = { 2, 2, 4, 1, 1, 1, 2, 2, 1 };
+
+#define SIGNAL_BLOCK_SIZE 256
+#define SIGNAL_MAX_COMPONENTS 16
+#define SIGNAL_TABLE_BITS 12
+
+struct SignalComponent {
+
+    int type;
+    double parameters[4];
+};
+
+// Composable synthetic sensor signal. The components are summed, then dropouts zero out runs of samples.
+// Samples are produced in blocks of SIGNAL_BLOCK_SIZE and every component runs as one branch-free loop over
+// the block, which the compiler can vectorize. Waveforms step a 32-bit phase accumulator through a sine table
+// with linear interpolation, and noise, spikes and dropouts draw from a counter-based hash of the sample index,
+// so every sample is independent of the others and a seed reproduces the same signal at any block size.
+class SignalSynthesizer {
+
+    private:
+
+        struct Oscillator {
+
+            uint32_t phase = 0;
+            uint32_t increment = 0;
+            double incrementStep = 0.0; // Chirp only, change of the increment per sample
+            double chirpIncrement = 0.0;
+            uint64_t sweepSamples = 0;
+            uint64_t sweepPosition = 0;
+        };
+
+        vector<SignalComponent> components;
+        vector<Oscillator> oscillators;     // One per component, only used by the waveforms
+        double sampleRate = 4.0;
+        uint64_t seed = 1;
+        uint64_t sampleIndex = 0;           // Index of the next sample to render
+        uint64_t dropoutRemaining = 0;
+        int burstLength = 1;
+        int burstPosition = 0;
+
+        double block[SIGNAL_BLOCK_SIZE];
+        size_t blockPosition = SIGNAL_BLOCK_SIZE;
+
+        // State before the current block was rendered, so that a change can rewind the samples next() has not served yet
+        uint64_t blockStartIndex = 0;
+        uint64_t blockDropoutRemaining = 0;
+        vector<Oscillator> blockOscillators;
+
+        static const vector<double>& sineTable() {
+
+            // One extra entry so that interpolation never wraps
+            static const vector<double> table = [] {
+
+                const double pi = acos(-1.0);
+                vector<double> values((1 << SIGNAL_TABLE_BITS) + 1);
+                for (size_t i = 0; i < values.size(); i++) values[i] = sin(2.0 * pi * i / (1 << SIGNAL_TABLE_BITS));
+                return values;
+            }();
+
+            return table;
+        }
+
+        // Inverse normal CDF at the centres of equal probability cells, scaled to unit variance
+        static const vector<double>& gaussianTable() {
+
+            static const vector<double> table = [] {
+
+                vector<double> values((1 << SIGNAL_TABLE_BITS) + 1);
+                size_t cells = values.size() - 1;
+
+                for (size_t i = 0; i < cells; i++) {
+
+                    double target = (i + 0.5) / cells;
+                    double low = -10.0, high = 10.0;
+                    for (int iteration = 0; iteration < 100; iteration++) {
+
+                        double middle = 0.5 * (low + high);
+                        if (0.5 * erfc(-middle / sqrt(2.0)) < target) low = middle;
+                        else high = middle;
+                    }
+                    values[i] = 0.5 * (low + high);
+                }
+
+                double variance = 0.0;
+                for (size_t i = 0; i < cells; i++) variance += values[i] * values[i];
+                double scale = 1.0 / sqrt(variance / cells);
+                for (size_t i = 0; i < cells; i++) values[i] *= scale;
+                values[cells] = values[cells - 1];
+                return values;
+            }();
+
+            return table;
+        }
+
+        // SplitMix64 finalizer, turns the stream key and sample index into 64 random bits
+        static uint64_t hash(uint64_t value) {
+
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+            return value ^ (value >> 31);
+        }
+
+        uint64_t streamKey(size_t component) {
+
+            return hash(this->seed * 0x9E3779B97F4A7C15ULL + component + 1);
+        }
+
+        uint32_t phaseIncrement(double frequency) {
+
+            double cycles = frequency / this->sampleRate;
+            cycles -= floor(cycles);
+            return static_cast<uint32_t>(static_cast<uint64_t>(llround(cycles * 4294967296.0)));
+        }
+
+        // Derive the per-sample increments from the parameters and the sample rate, phases are kept
+        void compile() {
+
+            this->oscillators.resize(this->components.size());
+            this->burstLength = 1;
+
+            for (size_t i = 0; i < this->components.size(); i++) {
+
+                const SignalComponent& component = this->components[i];
+                Oscillator& oscillator = this->oscillators[i];
+
+                switch (component.type) {
+
+                case SIGNAL_SINE:
+                case SIGNAL_SQUARE:
+
+                    oscillator.increment = phaseIncrement(component.parameters[1]);
+                    break;
+
+                case SIGNAL_CHIRP:
+
+                    oscillator.sweepSamples = max<uint64_t>(static_cast<uint64_t>(component.parameters[3] * this->sampleRate), 1);
+                    oscillator.sweepPosition %= oscillator.sweepSamples;
+                    oscillator.incrementStep = (component.parameters[2] - component.parameters[1]) / this->sampleRate * 4294967296.0 / oscillator.sweepSamples;
+                    oscillator.chirpIncrement = component.parameters[1] / this->sampleRate * 4294967296.0 + oscillator.incrementStep * oscillator.sweepPosition;
+                    break;
+
+                case SIGNAL_BURSTS:
+
+                    this->burstLength = max(this->burstLength, static_cast<int>(component.parameters[0]));
+                    break;
+
+                default:
+
+                    break;
+                }
+            }
+        }
+
+        // Return to the state after the last sample next() served, the rest of the block is dropped and produced
+        // again with the changed components. The served part is rendered once more to step the oscillators and dropouts.
+        void rewindUnread() {
+
+            if (this->blockPosition == SIGNAL_BLOCK_SIZE) return;
+
+            this->sampleIndex = this->blockStartIndex;
+            this->dropoutRemaining = this->blockDropoutRemaining;
+            this->oscillators = this->blockOscillators;
+            render(this->block, this->blockPosition);
+            this->blockPosition = SIGNAL_BLOCK_SIZE;
+        }
+
+        void render(double* output, size_t count) {
+
+            for (size_t start = 0; start < count; start += SIGNAL_BLOCK_SIZE) {
+
+                size_t length = min<size_t>(SIGNAL_BLOCK_SIZE, count - start);
+                double* target = output + start;
+                fill(target, target + length, 0.0);
+
+                for (size_t component = 0; component < this->components.size(); component++) {
+
+                    if (this->components[component].type != SIGNAL_DROPOUTS) runComponent(component, target, length, this->sampleIndex);
+                }
+
+                for (size_t component = 0; component < this->components.size(); component++) {
+
+                    if (this->components[component].type == SIGNAL_DROPOUTS) runDropouts(component, target, length, this->sampleIndex);
+                }
+
+                this->sampleIndex += length;
+            }
+        }
+
+        static double interpolate(const vector<double>& table, uint32_t position) {
+
+            uint32_t index = position >> (32 - SIGNAL_TABLE_BITS);
+            double fraction = (position & ((1u << (32 - SIGNAL_TABLE_BITS)) - 1)) * (1.0 / (1u << (32 - SIGNAL_TABLE_BITS)));
+            return table[index] + fraction * (table[index + 1] - table[index]);
+        }
+
+        void runComponent(size_t componentIndex, double* output, size_t count, uint64_t first) {
+
+            const SignalComponent& component = this->components[componentIndex];
+            Oscillator& oscillator = this->oscillators[componentIndex];
+            const double* parameters = component.parameters;
+
+            switch (component.type) {
+
+            case SIGNAL_SINE: {
+
+                const double amplitude = parameters[0];
+                const uint32_t phase = oscillator.phase, increment = oscillator.increment;
+                const vector<double>& sine = sineTable();
+
+                for (size_t i = 0; i < count; i++) output[i] += amplitude * interpolate(sine, phase + static_cast<uint32_t>(i) * increment);
+
+                oscillator.phase = phase + static_cast<uint32_t>(count) * increment;
+                break;
+            }
+
+            case SIGNAL_SQUARE: {
+
+                const double amplitude = parameters[0];
+                const uint32_t phase = oscillator.phase, increment = oscillator.increment;
+
+                for (size_t i = 0; i < count; i++) output[i] += (phase + static_cast<uint32_t>(i) * increment) < 0x80000000u ? amplitude : -amplitude;
+
+                oscillator.phase = phase + static_cast<uint32_t>(count) * increment;
+                break;
+            }
+
+            case SIGNAL_CHIRP: {
+
+                // The increment grows linearly until the sweep ends, then the sweep starts over at the start frequency
+                const double amplitude = parameters[0];
+                const double start = parameters[1] / this->sampleRate * 4294967296.0;
+                const vector<double>& sine = sineTable();
+
+                for (size_t i = 0; i < count; i++) {
+
+                    output[i] += amplitude * interpolate(sine, oscillator.phase);
+                    oscillator.phase += static_cast<uint32_t>(static_cast<int64_t>(oscillator.chirpIncrement));
+                    oscillator.chirpIncrement += oscillator.incrementStep;
+
+                    if (++oscillator.sweepPosition == oscillator.sweepSamples) {
+
+                        oscillator.sweepPosition = 0;
+                        oscillator.chirpIncrement = start;
+                    }
+                }
+                break;
+            }
+
+            case SIGNAL_NOISE: {
+
+                const double deviation = parameters[0];
+                const uint64_t key = streamKey(componentIndex);
+                const vector<double>& gaussian = gaussianTable();
+
+                for (size_t i = 0; i < count; i++) output[i] += deviation * interpolate(gaussian, static_cast<uint32_t>(hash(key + first + i) >> 32));
+                break;
+            }
+
+            case SIGNAL_DRIFT: {
+
+                const double perSample = parameters[0] / this->sampleRate;
+
+                for (size_t i = 0; i < count; i++) output[i] += perSample * static_cast<double>(first + i);
+                break;
+            }
+
+            case SIGNAL_OFFSET: {
+
+                const double level = parameters[0];
+
+                for (size_t i = 0; i < count; i++) output[i] += level;
+                break;
+            }
+
+            case SIGNAL_SPIKES: {
+
+                // 53 random bits decide whether the sample spikes, the lowest bit its sign
+                const uint64_t threshold = static_cast<uint64_t>(parameters[0] * 9007199254740992.0);
+                const double amplitude = parameters[1];
+                const uint64_t key = streamKey(componentIndex);
+
+                for (size_t i = 0; i < count; i++) {
+
+                    uint64_t bits = hash(key + first + i);
+                    output[i] += (bits >> 11) < threshold ? ((bits & 1) ? amplitude : -amplitude) : 0.0;
+                }
+                break;
+            }
+
+            default:
+
+                break;
+            }
+        }
+
+        void runDropouts(size_t componentIndex, double* output, size_t count, uint64_t first) {
+
+            const SignalComponent& component = this->components[componentIndex];
+            const uint64_t threshold = static_cast<uint64_t>(component.parameters[0] * 9007199254740992.0);
+            const uint64_t length = static_cast<uint64_t>(component.parameters[1]);
+            const uint64_t key = streamKey(componentIndex);
+
+            for (size_t i = 0; i < count; i++) {
+
+                if (this->dropoutRemaining == 0 && (hash(key + first + i) >> 11) < threshold) this->dropoutRemaining = length;
+
+                if (this->dropoutRemaining > 0) {
+
+                    output[i] = 0.0;
+                    this->dropoutRemaining--;
+                }
+            }
+        }
+
+    public:
+
+        SignalSynthesizer() {
+
+            compile();
+        }
+
+        // Validates the parameters against the component type, returns false for an invalid component
+        bool addComponent(int type, const vector<double>& parameters) {
+
+            if (type < 0 || type >= SIGNAL_COMPONENT_TYPES || this->components.size() >= SIGNAL_MAX_COMPONENTS) return false;
+            if (parameters.size() != static_cast<size_t>(signalComponentParameterCount[type])) return false;
+            for (double parameter : parameters) if (!isfinite(parameter)) return false;
+
+            switch (type) {
+
+            case SIGNAL_SINE:
+            case SIGNAL_SQUARE:
+
+                if (parameters[1] < 0.0) return false;
+                break;
+
+            case SIGNAL_CHIRP:
+
+                if (parameters[1] < 0.0 || parameters[2] < 0.0 || parameters[3] <= 0.0) return false;
+                break;
+
+            case SIGNAL_NOISE:
+
+                if (parameters[0] < 0.0) return false;
+                break;
+
+            case SIGNAL_SPIKES:
+
+                if (parameters[0] < 0.0 || parameters[0] > 1.0) return false;
+                break;
+
+            case SIGNAL_DROPOUTS:
+
+                if (parameters[0] < 0.0 || parameters[0] > 1.0 || parameters[1] < 1.0) return false;
+                break;
+
+            case SIGNAL_BURSTS:
+
+                if (parameters[0] < 1.0 || parameters[0] > 100000.0) return false;
+                break;
+
+            default:
+
+                break;
+            }
+
+            rewindUnread();
+
+            SignalComponent component{ type, {} };
+            copy(parameters.begin(), parameters.end(), component.parameters);
+            this->components.push_back(component);
+            this->oscillators.push_back(Oscillator());
+            compile();
+            return true;
+        }
+
+        void clear() {
+
+            rewindUnread();
+            this->components.clear();
+            this->oscillators.clear();
+            compile();
+        }
+
+        // Restart the signal from sample 0 with the given seed
+        void reset(uint64_t seed) {
+
+            this->seed = seed;
+            this->sampleIndex = 0;
+            this->dropoutRemaining = 0;
+            this->burstPosition = 0;
+            this->blockPosition = SIGNAL_BLOCK_SIZE;
+            this->oscillators.assign(this->components.size(), Oscillator());
+            compile();
+        }
+
+        // Samples per second, the frequencies and the drift rate are converted with it
+        void setSampleRate(double hz) {
+
+            if (hz <= 0.0 || hz == this->sampleRate) return;
+
+            rewindUnread();
+            this->sampleRate = hz;
+            compile();
+        }
+
+        // Write the next count samples, continuing where the previous call stopped. Samples next() has already
+        // produced but not served come first, so both can be mixed.
+        void generate(double* output, size_t count) {
+
+            size_t unread = min<size_t>(SIGNAL_BLOCK_SIZE - this->blockPosition, count);
+            copy(this->block + this->blockPosition, this->block + this->blockPosition + unread, output);
+            this->blockPosition += unread;
+
+            render(output + unread, count - unread);
+        }
+
+        // One sample at a time, served from an internal block
+        double next() {
+
+            if (this->blockPosition == SIGNAL_BLOCK_SIZE) {
+
+                this->blockStartIndex = this->sampleIndex;
+                this->blockDropoutRemaining = this->dropoutRemaining;
+                this->blockOscillators = this->oscillators;
+                render(this->block, SIGNAL_BLOCK_SIZE);
+                this->blockPosition = 0;
+            }
+
+            return this->block[this->blockPosition++];
+        }
+
+        // Delay before the next sample. With bursts, burstLength - 1 samples follow each other immediately and the
+        // last one waits for the whole burst, so the average rate stays the same.
+        int arrivalDelay(int delay) {
+
+            if (this->burstLength <= 1) return delay;
+
+            this->burstPosition = (this->burstPosition + 1) % this->burstLength;
+            return this->burstPosition == 0 ? delay * this->burstLength : 0;
+        }
+
+        const vector<SignalComponent>& getComponents() {
+
+            return this->components;
+        }
+
+        double getSampleRate() {
+
+            return this->sampleRate;
+        }
+
+        string describe() {
+
+            if (this->components.empty()) return "Silent";
+
+            ostringstream text;
+            for (size_t i = 0; i < this->components.size(); i++) {
+
+                text << (i > 0 ? " + " : "") << signalComponentNames[this->components[i].type];
+            }
+            return text.str();
+        }
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <queue>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+
+using namespace std;
+
+// Wall clock time in nanoseconds since the epoch
+inline int64_t wallClockNs() {
+
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Time base of the sample, export and anomaly timestamps, the wall clock unless a virtual-time run replaced it
+inline function<int64_t()> timestampSource = wallClockNs;
+
+inline int64_t currentTimestampNs() {
+
+    return timestampSource();
+}
+
+// Discrete-event clock for virtual-time simulation. Events are kept in time order and the clock jumps
+// straight to the next event instead of sleeping, so simulated hours run in seconds. Events scheduled for
+// the same time run in the order they were scheduled, which keeps runs reproducible.
+class SimulationClock {
+
+    private:
+
+        struct Event {
+
+            uint64_t time;
+            uint64_t sequence;
+            function<void()> action;
+
+            bool operator>(const Event& other) const {
+
+                return time != other.time ? time > other.time : sequence > other.sequence;
+            }
+        };
+
+        priority_queue<Event, vector<Event>, greater<Event>> events;
+        uint64_t currentTime = 0;
+        uint64_t nextSequence = 0;
+        uint64_t processedEvents = 0;
+        bool stopped = false;
+
+    public:
+
+        // Current virtual time in milliseconds
+        uint64_t now() {
+
+            return this->currentTime;
+        }
+
+        void schedule(uint64_t delayMs, function<void()> action) {
+
+            this->events.push({ this->currentTime + delayMs, this->nextSequence++, move(action) });
+        }
+
+        // Run every event due up to endTime, then leave the clock at endTime unless an event stopped it
+        void runUntil(uint64_t endTime) {
+
+            this->stopped = false;
+
+            while (!this->stopped && !this->events.empty() && this->events.top().time <= endTime) {
+
+                Event event = this->events.top();
+                this->events.pop();
+
+                this->currentTime = event.time;
+                event.action();
+                this->processedEvents++;
+            }
+
+            if (!this->stopped) this->currentTime = endTime;
+        }
+
+        // End runUntil after the current event
+        void stop() {
+
+            this->stopped = true;
+        }
+
+        uint64_t getProcessedEvents() {
+
+            return this->processedEvents;
+        }
+};
+
+// Points the timestamps at a simulation clock while in scope. Simulated time starts at the wall clock time the run
+// started at, so the timestamps of a virtual run read like those of a real run of the same length.
+class SimulationTimestamps {
+
+    private:
+
+        function<int64_t()> previous;
+
+    public:
+
+        SimulationTimestamps(SimulationClock& clock) : previous(timestampSource) {
+
+            int64_t startNs = wallClockNs() - static_cast<int64_t>(clock.now()) * 1000000;
+            timestampSource = [&clock, startNs] { return startNs + static_cast<int64_t>(clock.now()) * 1000000; };
+        }
+
+        ~SimulationTimestamps() {
+
+            timestampSource = this->previous;
+        }
+};
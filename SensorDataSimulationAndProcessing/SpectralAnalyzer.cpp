@@ -0,0 +1,340 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "ThreadPlacement.cpp"
+
+using namespace std;
+
+#define SPECTRAL_BANDS 4
+#define SPECTRAL_MIN_FRAME 8
+#define SPECTRAL_MAX_FRAME 4096
+
+// Frequency-domain statistics of the sample stream. Incoming samples go into a ring of the last frameSize
+// samples, and every hopSize samples one mean-removed, Hann-windowed frame is transformed, so overlapping
+// frames cost one FFT per hop instead of a full recomputation on every refresh. The real-input FFT packs the
+// frame into a complex sequence of half the length, runs an iterative radix-2 transform with per-stage
+// contiguous twiddle tables and splits the result into the real spectrum. The power spectrum is averaged
+// over recent frames and reduced to the dominant frequency, the energy share of equal-width bands and the
+// spectral flatness.
+class SpectralAnalyzer {
+
+    private:
+
+        size_t frameSize = 0;   // 0 - Disabled
+        size_t hopSize = 0;
+        double sampleRate = 1.0;
+        double smoothing = 0.25; // Weight of the newest frame in the averaged spectrum
+
+        // Tables, rebuilt when the frame size changes
+        vector<double> window;
+        vector<uint32_t> bitReverse;            // Permutation of the half-length complex transform
+        vector<complex<double>> stageTwiddles;  // Twiddles of every butterfly stage back to back, stage with span h starts at h - 1
+        vector<complex<double>> splitTwiddles;  // exp(-2 pi i k / frameSize) for k in [0, frameSize / 2]
+
+        // Sample ring and frame state
+        vector<double> history;
+        size_t historyHead = 0;
+        uint64_t samplesSeen = 0;
+        size_t samplesSinceFrame = 0;
+        uint64_t frameCount = 0;
+
+        // Scratch and results
+        vector<double> frame;
+        vector<complex<double>> buffer;
+        vector<complex<double>> spectrum;
+        vector<double> averagedPower;
+        double dominantFrequency = 0.0;
+        double spectralFlatness = 0.0;
+        double bandEnergy[SPECTRAL_BANDS] = {};
+
+        static complex<double> multiply(const complex<double>& a, const complex<double>& b) {
+
+            // Written out, operator* checks for NaN and infinity on every product
+            return { a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() };
+        }
+
+        void buildTables() {
+
+            const double pi = acos(-1.0);
+            size_t half = this->frameSize / 2;
+
+            this->window.resize(this->frameSize);
+            for (size_t n = 0; n < this->frameSize; n++) {
+
+                this->window[n] = 0.5 - 0.5 * cos(2.0 * pi * n / this->frameSize);
+            }
+
+            int bits = 0;
+            while ((size_t(1) << bits) < half) bits++;
+
+            this->bitReverse.resize(half);
+            for (size_t i = 0; i < half; i++) {
+
+                uint32_t reversed = 0;
+                for (int b = 0; b < bits; b++) {
+
+                    if (i & (size_t(1) << b)) reversed |= 1u << (bits - 1 - b);
+                }
+                this->bitReverse[i] = reversed;
+            }
+
+            this->stageTwiddles.clear();
+            for (size_t span = 1; span < half; span <<= 1) {
+
+                for (size_t j = 0; j < span; j++) {
+
+                    double angle = -pi * j / span;
+                    this->stageTwiddles.push_back({ cos(angle), sin(angle) });
+                }
+            }
+
+            this->splitTwiddles.resize(half + 1);
+            for (size_t k = 0; k <= half; k++) {
+
+                double angle = -2.0 * pi * k / this->frameSize;
+                this->splitTwiddles[k] = { cos(angle), sin(angle) };
+            }
+
+            this->frame.assign(this->frameSize, 0.0);
+            this->buffer.assign(half, 0.0);
+            this->spectrum.assign(half + 1, 0.0);
+            this->averagedPower.assign(half + 1, 0.0);
+        }
+
+        void computeFrame() {
+
+            size_t mask = this->frameSize - 1;
+
+            double mean = 0.0;
+            for (double sample : this->history) mean += sample;
+            mean /= this->frameSize;
+
+            // Oldest sample first, the ring head points at it. The offset is removed so that the window does not
+            // spread a large DC component into the lowest bins.
+            for (size_t n = 0; n < this->frameSize; n++) {
+
+                this->frame[n] = (this->history[(this->historyHead + n) & mask] - mean) * this->window[n];
+            }
+
+            realTransform(this->frame.data(), this->spectrum);
+
+            double weight = this->frameCount == 0 ? 1.0 : this->smoothing;
+            for (size_t k = 0; k < this->spectrum.size(); k++) {
+
+                double power = norm(this->spectrum[k]);
+                this->averagedPower[k] += weight * (power - this->averagedPower[k]);
+            }
+
+            this->frameCount++;
+            updateStatistics();
+        }
+
+        void updateStatistics() {
+
+            size_t bins = this->averagedPower.size() - 1; // Bins 1..frameSize / 2, the DC bin is left out
+            double total = 0.0;
+            double logSum = 0.0;
+            size_t peak = 1;
+            fill(this->bandEnergy, this->bandEnergy + SPECTRAL_BANDS, 0.0);
+
+            for (size_t k = 1; k <= bins; k++) {
+
+                double power = this->averagedPower[k];
+                total += power;
+                logSum += log(power + 1e-300);
+                this->bandEnergy[min<size_t>(k * SPECTRAL_BANDS / (bins + 1), SPECTRAL_BANDS - 1)] += power;
+
+                if (power > this->averagedPower[peak]) peak = k;
+            }
+
+            if (total <= 0.0) {
+
+                this->dominantFrequency = 0.0;
+                this->spectralFlatness = 0.0;
+                return;
+            }
+
+            for (double& energy : this->bandEnergy) energy /= total;
+
+            // Geometric over arithmetic mean, 1 for white noise and close to 0 for a pure tone
+            this->spectralFlatness = min(exp(logSum / bins) / (total / bins), 1.0);
+
+            // Parabolic interpolation between the peak and its neighbours
+            double offset = 0.0;
+            if (peak > 1 && peak < bins) {
+
+                double left = this->averagedPower[peak - 1], center = this->averagedPower[peak], right = this->averagedPower[peak + 1];
+                double denominator = left - 2.0 * center + right;
+                if (denominator != 0.0) offset = 0.5 * (left - right) / denominator;
+            }
+
+            this->dominantFrequency = (peak + offset) * this->sampleRate / this->frameSize;
+        }
+
+    public:
+
+        SpectralAnalyzer(size_t frameSize = 64, size_t hopSize = 32) {
+
+            configure(frameSize, hopSize);
+        }
+
+        // frameSize must be a power of two between SPECTRAL_MIN_FRAME and SPECTRAL_MAX_FRAME, or 0 to disable.
+        // Clears the sample history and the averaged spectrum.
+        bool configure(size_t frameSize, size_t hopSize) {
+
+            bool powerOfTwo = (frameSize & (frameSize - 1)) == 0;
+            if (frameSize != 0 && (!powerOfTwo || frameSize < SPECTRAL_MIN_FRAME || frameSize > SPECTRAL_MAX_FRAME || hopSize == 0 || hopSize > frameSize)) {
+
+                return false;
+            }
+
+            this->frameSize = frameSize;
+            this->hopSize = hopSize;
+            this->history.assign(frameSize, 0.0);
+            this->historyHead = 0;
+            this->samplesSeen = 0;
+            this->samplesSinceFrame = 0;
+            this->frameCount = 0;
+            this->dominantFrequency = 0.0;
+            this->spectralFlatness = 0.0;
+            fill(this->bandEnergy, this->bandEnergy + SPECTRAL_BANDS, 0.0);
+
+            if (frameSize != 0) buildTables();
+            return true;
+        }
+
+        // Reallocate the tables, the sample ring and the scratch buffers from the calling thread, see ThreadPlacement
+        void localizeBuffers() {
+
+            localizeVector(this->window);
+            localizeVector(this->bitReverse);
+            localizeVector(this->stageTwiddles);
+            localizeVector(this->splitTwiddles);
+            localizeVector(this->history);
+            localizeVector(this->frame);
+            localizeVector(this->buffer);
+            localizeVector(this->spectrum);
+            localizeVector(this->averagedPower);
+        }
+
+        // Sample rate in Hz, only used to convert bins to frequencies
+        void setSampleRate(double hz) {
+
+            if (hz > 0.0) this->sampleRate = hz;
+        }
+
+        template<typename T>
+        void addSamples(const vector<T>& samples) {
+
+            if (this->frameSize == 0) return;
+
+            size_t mask = this->frameSize - 1;
+            for (const T& sample : samples) {
+
+                this->history[this->historyHead] = static_cast<double>(sample);
+                this->historyHead = (this->historyHead + 1) & mask;
+                this->samplesSeen++;
+                this->samplesSinceFrame++;
+
+                if (this->samplesSeen >= this->frameSize && this->samplesSinceFrame >= this->hopSize) {
+
+                    computeFrame();
+                    this->samplesSinceFrame = 0;
+                }
+            }
+        }
+
+        // Spectrum of frameSize real samples, bins 0..frameSize / 2 are written to output. No window is applied.
+        void realTransform(const double* input, vector<complex<double>>& output) {
+
+            size_t half = this->frameSize / 2;
+            output.resize(half + 1);
+
+            // Even samples as real and odd samples as imaginary parts, stored in bit-reversed order
+            for (size_t n = 0; n < half; n++) {
+
+                this->buffer[this->bitReverse[n]] = { input[2 * n], input[2 * n + 1] };
+            }
+
+            for (size_t span = 1; span < half; span <<= 1) {
+
+                const complex<double>* twiddles = this->stageTwiddles.data() + (span - 1);
+
+                for (size_t start = 0; start < half; start += 2 * span) {
+
+                    complex<double>* low = this->buffer.data() + start;
+                    complex<double>* high = low + span;
+
+                    for (size_t j = 0; j < span; j++) {
+
+                        complex<double> product = multiply(high[j], twiddles[j]);
+                        high[j] = low[j] - product;
+                        low[j] += product;
+                    }
+                }
+            }
+
+            // Separate the transforms of the even and odd samples and combine them into the real spectrum
+            for (size_t k = 0; k <= half; k++) {
+
+                complex<double> current = this->buffer[k % half];
+                complex<double> mirrored = conj(this->buffer[(half - k) % half]);
+
+                complex<double> even = (current + mirrored) * 0.5;
+                complex<double> odd = multiply(current - mirrored, { 0.0, -0.5 });
+                output[k] = even + multiply(this->splitTwiddles[k], odd);
+            }
+        }
+
+        bool isEnabled() {
+
+            return this->frameSize != 0;
+        }
+
+        size_t getFrameSize() {
+
+            return this->frameSize;
+        }
+
+        size_t getHopSize() {
+
+            return this->hopSize;
+        }
+
+        double getSampleRate() {
+
+            return this->sampleRate;
+        }
+
+        uint64_t getFrameCount() {
+
+            return this->frameCount;
+        }
+
+        // Frequency with the most energy in the averaged spectrum, in Hz
+        double getDominantFrequency() {
+
+            return this->dominantFrequency;
+        }
+
+        double getSpectralFlatness() {
+
+            return this->spectralFlatness;
+        }
+
+        // Share of the energy in band index, bands split 0..sampleRate / 2 into SPECTRAL_BANDS equal parts
+        double getBandEnergy(int index) {
+
+            return index >= 0 && index < SPECTRAL_BANDS ? this->bandEnergy[index] : 0.0;
+        }
+
+        const vector<double>& getAveragedPower() {
+
+            return this->averagedPower;
+        }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+
+#include "DataProcessor.cpp"
+
+using namespace std;
+
+// Helpers shared by SensorDataTests and SensorDataBenchmarks
+
+// Access to the private DataProcessor steps that are tested and measured on their own
+template<typename dataType>
+struct DataProcessorProbe {
+
+    static void movingAverageFilter(DataProcessor<dataType>& processor) {
+
+        processor.movingAverageFilter();
+    }
+};
+
+// The setters report to cout, tests and benchmarks silence them while configuring
+class QuietOutput {
+
+    private:
+
+        ostringstream sink;
+        streambuf* previous;
+
+    public:
+
+        QuietOutput() : previous(cout.rdbuf(sink.rdbuf())) {}
+        ~QuietOutput() { cout.rdbuf(this->previous); }
+};
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <iostream>
+#include <climits>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+using namespace std;
+
+// CPU pinning and real-time priority of one long-running thread, the generation or the processing thread.
+// The settings can change at any time from the command thread; the placed thread picks them up with
+// applyIfChanged() on its next iteration, because affinity and scheduling can only be changed cheaply for
+// the calling thread. After a move the thread should reallocate its buffers: Linux places a page on the
+// NUMA node of the thread that first writes it, so buffers written after pinning are local to that CPU.
+// Several threads can share one placement, each keeping its own applied version.
+class ThreadPlacement {
+
+    private:
+
+        atomic<int> cpu{ -1 };          // -1 - Any CPU
+        atomic<int> rtPriority{ 0 };    // 0 - Default scheduling, 1..99 - SCHED_FIFO priority
+        atomic<unsigned int> version{ 0 };
+        atomic<bool> realtimeActive{ false };
+        atomic<bool> realtimeDenied{ false };
+        atomic<bool> pinningFailed{ false };
+        unsigned int appliedVersion = UINT_MAX; // Only touched by the placed thread
+
+#ifdef __linux__
+        // Affinity of the process at startup, restored when pinning is turned off
+        static const cpu_set_t& initialAffinity() {
+
+            static cpu_set_t mask = [] {
+
+                cpu_set_t initial;
+                CPU_ZERO(&initial);
+                if (sched_getaffinity(0, sizeof(initial), &initial) != 0) {
+
+                    for (int i = 0; i < CPU_SETSIZE; i++) CPU_SET(i, &initial);
+                }
+                return initial;
+            }();
+
+            return mask;
+        }
+#endif
+
+        void applySettings() {
+
+#ifdef __linux__
+            // Read before any thread is pinned, the first call records the unpinned affinity
+            const cpu_set_t& unpinned = initialAffinity();
+
+            int target = this->cpu;
+            cpu_set_t mask;
+
+            if (target >= 0) {
+
+                CPU_ZERO(&mask);
+                CPU_SET(target, &mask);
+            }
+            else {
+
+                mask = unpinned;
+            }
+
+            // Fails for a CPU that went offline or was taken away by a cpuset since it was set
+            this->pinningFailed = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0;
+
+            // SCHED_FIFO needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance, without it the thread keeps its policy
+            int priority = this->rtPriority;
+            sched_param parameters{};
+            parameters.sched_priority = priority;
+
+            bool applied = pthread_setschedparam(pthread_self(), priority > 0 ? SCHED_FIFO : SCHED_OTHER, &parameters) == 0;
+            this->realtimeActive = priority > 0 && applied;
+            this->realtimeDenied = priority > 0 && !applied;
+#endif
+        }
+
+    public:
+
+        static int getCpuCount() {
+
+            return max(static_cast<int>(thread::hardware_concurrency()), 1);
+        }
+
+        // True when the process may run on the CPU, cpusets and taskset can exclude CPUs that exist
+        static bool isCpuAllowed(int cpu) {
+
+#ifdef __linux__
+            return cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &initialAffinity());
+#else
+            return false;
+#endif
+        }
+
+        // The CPUs the process may run on as ranges, e.g. "0-3,8"
+        static string describeAllowedCpus() {
+
+            string text;
+
+#ifdef __linux__
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+
+                if (!isCpuAllowed(cpu) || isCpuAllowed(cpu - 1)) continue;
+
+                int last = cpu;
+                while (isCpuAllowed(last + 1)) last++;
+
+                if (!text.empty()) text += ",";
+                text += last == cpu ? to_string(cpu) : to_string(cpu) + "-" + to_string(last);
+            }
+#endif
+
+            return text;
+        }
+
+        // NUMA node of a CPU, -1 when unknown
+        static int getNumaNode(int cpu) {
+
+#ifdef __linux__
+            if (cpu < 0) return -1;
+
+            string path = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+            DIR* directory = opendir(path.c_str());
+            if (directory == nullptr) return -1;
+
+            int node = -1;
+            while (dirent* entry = readdir(directory)) {
+
+                if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+
+                    node = atoi(entry->d_name + 4);
+                    break;
+                }
+            }
+
+            closedir(directory);
+            return node;
+#else
+            return -1;
+#endif
+        }
+
+        // CPU the calling thread is running on right now, -1 when unknown
+        static int getCurrentCpu() {
+
+#ifdef __linux__
+            return sched_getcpu();
+#else
+            return -1;
+#endif
+        }
+
+        bool setCpu(int value) {
+
+#ifdef __linux__
+            if (value != -1 && !isCpuAllowed(value)) {
+
+                cout << "Invalid CPU. CPU must be one of the CPUs this process may run on (" << describeAllowedCpus() << "), -1 - Any CPU";
+                return false;
+            }
+
+            this->cpu = value;
+            this->version++;
+            cout << "Thread CPU successfully set.";
+            return true;
+#else
+            cout << "CPU pinning is only supported on Linux.";
+            return false;
+#endif
+        }
+
+        // quiet skips the success message, used when one setting is applied to several threads
+        bool setRealtimePriority(int value, bool quiet = false) {
+
+#ifdef __linux__
+            if (value != 0 && (value < sched_get_priority_min(SCHED_FIFO) || value > sched_get_priority_max(SCHED_FIFO))) {
+
+                cout << "Invalid real-time priority. 0 - Default scheduling, " << sched_get_priority_min(SCHED_FIFO) << ".." << sched_get_priority_max(SCHED_FIFO) << " - SCHED_FIFO priority";
+                return false;
+            }
+
+            this->rtPriority = value;
+            this->version++;
+            if (!quiet) cout << "Thread real-time priority successfully set.";
+            return true;
+#else
+            cout << "Real-time scheduling is only supported on Linux.";
+            return false;
+#endif
+        }
+
+        // Apply the settings to the calling thread unconditionally, used when a new thread takes over the placement
+        void apply() {
+
+            this->appliedVersion = this->version;
+            applySettings();
+        }
+
+        // Apply the settings if they changed since the calling thread last applied them.
+        // Returns true when the thread was moved, so that it can reallocate its buffers on the new node.
+        bool applyIfChanged() {
+
+            return applyIfChanged(this->appliedVersion);
+        }
+
+        // For threads that share the placement, appliedVersion belongs to the calling thread and starts at UINT_MAX
+        bool applyIfChanged(unsigned int& appliedVersion) {
+
+            unsigned int current = this->version;
+            if (appliedVersion == current) return false;
+
+            appliedVersion = current;
+            applySettings();
+            return true;
+        }
+
+        // Changes with every setting, lets the users of the placed threads notice a move
+        unsigned int getVersion() {
+
+            return this->version;
+        }
+
+        int getCpu() {
+
+            return this->cpu;
+        }
+
+        int getRealtimePriority() {
+
+            return this->rtPriority;
+        }
+
+        // True when the last apply() switched the thread to SCHED_FIFO
+        bool isRealtimeActive() {
+
+            return this->realtimeActive;
+        }
+
+        // True when the last apply() could not pin the thread to the CPU
+        bool isPinningFailed() {
+
+            return this->pinningFailed;
+        }
+
+        string describe() {
+
+            int target = this->cpu;
+            int priority = this->rtPriority;
+            string text = target < 0 ? "Any" : to_string(target);
+
+            int node = getNumaNode(target);
+            if (node >= 0) text += " (node " + to_string(node) + ")";
+            if (this->pinningFailed) text += " failed";
+
+            if (priority > 0) {
+
+                text += ", FIFO " + to_string(priority);
+                if (this->realtimeDenied) text += " denied";
+            }
+
+            return text;
+        }
+};
+
+// Copy a buffer into an allocation written by the calling thread, so that its pages are local to the thread's
+// NUMA node. spare reserves room for buffers that briefly grow past their size.
+template<typename T>
+void localizeVector(vector<T>& buffer, size_t spare = 0) {
+
+    vector<T> local;
+    local.reserve(buffer.size() + spare);
+    local.assign(buffer.begin(), buffer.end());
+    buffer.swap(local);
+}